@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BatchReader.h"
+#include "Trace.h"
+#include "Utils.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <initializer_list>
+
+namespace
+{
+	// a minimal io_uring over the raw syscalls, so there is no liburing dependency
+	class Ring
+	{
+	public:
+		~Ring()
+		{
+			if (sqRing && sqRing != MAP_FAILED)
+				munmap(sqRing, sqRingSize);
+			if (cqRing && cqRing != sqRing && cqRing != MAP_FAILED)
+				munmap(cqRing, cqRingSize);
+			if (sqes && sqes != MAP_FAILED)
+				munmap(sqes, sqesSize);
+			if (fd >= 0)
+				close(fd);
+		}
+
+		bool init(unsigned entries)
+		{
+			io_uring_params params;
+			memset(&params, 0, sizeof(params));
+			fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+			if (fd < 0)
+				return false;
+
+			sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+			if (single)
+				sqRingSize = cqRingSize = sqRingSize > cqRingSize ? sqRingSize : cqRingSize;
+
+			sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+			if (sqRing == MAP_FAILED)
+				return false;
+			cqRing = single ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+			if (cqRing == MAP_FAILED)
+				return false;
+			sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			sqes = (io_uring_sqe*)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+			if (sqes == MAP_FAILED)
+				return false;
+
+			char* sq = (char*)sqRing;
+			sqHead = (unsigned*)(sq + params.sq_off.head);
+			sqTail = (unsigned*)(sq + params.sq_off.tail);
+			sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+			sqEntries = params.sq_entries;
+			sqArray = (unsigned*)(sq + params.sq_off.array);
+			char* cq = (char*)cqRing;
+			cqHead = (unsigned*)(cq + params.cq_off.head);
+			cqTail = (unsigned*)(cq + params.cq_off.tail);
+			cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+			cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+			return true;
+		}
+
+		// the probe itself needs 5.6, the same as openat and statx
+		bool supports(std::initializer_list<int> ops)
+		{
+			const int count = 256;
+			size_t size = sizeof(io_uring_probe) + count * sizeof(io_uring_probe_op);
+			std::vector<unsigned char> buffer(size, 0);
+			io_uring_probe* probe = (io_uring_probe*)buffer.data();
+			if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, count) < 0)
+				return false;
+			for (int op : ops)
+				if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+					return false;
+			return true;
+		}
+
+		// null when the submission queue is full
+		io_uring_sqe* next()
+		{
+			unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+			if (tail - head >= sqEntries)
+				return nullptr;
+			unsigned index = tail & sqMask;
+			sqArray[index] = index;
+			++tail;
+			++queued;
+			io_uring_sqe* sqe = &sqes[index];
+			memset(sqe, 0, sizeof(*sqe));
+			return sqe;
+		}
+
+		// publishes queued entries and waits for at least one completion
+		bool submitAndWait()
+		{
+			__atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+			for (;;)
+			{
+				int submitted = (int)syscall(__NR_io_uring_enter, fd, queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+				if (submitted >= 0)
+				{
+					queued -= (unsigned)submitted;
+					return true;
+				}
+				if (errno != EINTR && errno != EAGAIN)
+					return false;
+			}
+		}
+
+		bool pop(io_uring_cqe& out)
+		{
+			unsigned head = *cqHead;
+			if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+				return false;
+			out = cqes[head & cqMask];
+			__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+			return true;
+		}
+
+	private:
+		int fd = -1;
+		void* sqRing = nullptr;
+		void* cqRing = nullptr;
+		io_uring_sqe* sqes = nullptr;
+		size_t sqRingSize = 0, cqRingSize = 0, sqesSize = 0;
+		unsigned* sqHead = nullptr;
+		unsigned* sqTail = nullptr;
+		unsigned* sqArray = nullptr;
+		unsigned sqMask = 0, sqEntries = 0;
+		unsigned* cqHead = nullptr;
+		unsigned* cqTail = nullptr;
+		unsigned cqMask = 0;
+		io_uring_cqe* cqes = nullptr;
+		unsigned tail = 0;
+		unsigned queued = 0;
+	};
+
+	bool ringSupported()
+	{
+		Ring ring;
+		return ring.init(2) && ring.supports({ IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE });
+	}
+
+	// user_data carries the slot and which step completed
+	enum Step { Open, Stat, Read, Close };
+
+	struct Slot
+	{
+		int index = -1;
+		int fd = -1;
+		int waiting = 0;
+		bool failed = false;
+		struct statx stat;
+		unsigned char* data = nullptr;
+		size_t size = 0;
+		size_t offset = 0;
+	};
+
+	unsigned long long tag(int slot, Step step)
+	{
+		return (unsigned long long)slot << 2 | step;
+	}
+
+	// Runs every path through the ring. Returns false, having read nothing,
+	// if io_uring or one of the ops it needs is not available, so the caller
+	// can fall back.
+	bool readWithRing(const std::vector<std::string>& paths, const std::function<void(int, unsigned char*, size_t)>& onRead, int& read)
+	{
+		Ring ring;
+		// up to two entries (open + statx) per slot can be queued at once
+		if (!ring.init(BatchReader::IN_FLIGHT * 2)
+			|| !ring.supports({ IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE }))
+			return false;
+
+		Slot slots[BatchReader::IN_FLIGHT];
+		int nextPath = 0;
+		int active = 0;
+		bool submitted = false;
+
+		auto finish = [&](int s)
+		{
+			Slot& slot = slots[s];
+			if (slot.fd >= 0)
+			{
+				io_uring_sqe* sqe = ring.next();
+				sqe->opcode = IORING_OP_CLOSE;
+				sqe->fd = slot.fd;
+				sqe->user_data = tag(s, Close);
+				slot.fd = -1;
+				slot.waiting = 1;
+				return;
+			}
+			if (!slot.failed && slot.data)
+			{
+				onRead(slot.index, slot.data, slot.size);
+				++read;
+			}
+			else
+				free(slot.data);
+			slot = Slot();
+			--active;
+		};
+
+		auto queueRead = [&](int s)
+		{
+			Slot& slot = slots[s];
+			io_uring_sqe* sqe = ring.next();
+			sqe->opcode = IORING_OP_READ;
+			sqe->fd = slot.fd;
+			sqe->addr = (unsigned long long)(slot.data + slot.offset);
+			sqe->len = (unsigned)(slot.size - slot.offset);
+			sqe->off = slot.offset;
+			sqe->user_data = tag(s, Read);
+			slot.waiting = 1;
+		};
+
+		for (;;)
+		{
+			// fill free slots with new paths; open and statx go out together
+			for (int s = 0; s < BatchReader::IN_FLIGHT && nextPath < (int)paths.size(); ++s)
+			{
+				Slot& slot = slots[s];
+				if (slot.index >= 0)
+					continue;
+				slot.index = nextPath++;
+				slot.waiting = 2;
+				++active;
+
+				io_uring_sqe* open = ring.next();
+				open->opcode = IORING_OP_OPENAT;
+				open->fd = AT_FDCWD;
+				open->addr = (unsigned long long)paths[slot.index].c_str();
+				open->open_flags = O_RDONLY | O_CLOEXEC;
+				open->user_data = tag(s, Open);
+
+				io_uring_sqe* stat = ring.next();
+				stat->opcode = IORING_OP_STATX;
+				stat->fd = AT_FDCWD;
+				stat->addr = (unsigned long long)paths[slot.index].c_str();
+				stat->len = STATX_SIZE;
+				stat->off = (unsigned long long)&slot.stat;
+				stat->user_data = tag(s, Stat);
+			}
+			if (active == 0)
+				return true;
+			if (!ring.submitAndWait())
+			{
+				// falling back is only safe before the kernel holds any of our buffers
+				if (!submitted)
+					return false;
+				fprintf(stderr, "io_uring_enter failed: %s\n", strerror(errno));
+				return true;
+			}
+			submitted = true;
+
+			io_uring_cqe cqe;
+			while (ring.pop(cqe))
+			{
+				int s = (int)(cqe.user_data >> 2);
+				Step step = (Step)(cqe.user_data & 3);
+				Slot& slot = slots[s];
+				--slot.waiting;
+
+				if (step == Open)
+				{
+					if (cqe.res >= 0)
+						slot.fd = cqe.res;
+					else
+						slot.failed = true;
+				}
+				else if (step == Stat && cqe.res < 0)
+					slot.failed = true;
+				else if (step == Read)
+				{
+					if (cqe.res <= 0)
+						slot.failed = true;
+					else
+						slot.offset += (size_t)cqe.res;
+				}
+
+				if (slot.waiting > 0)
+					continue;
+				if (step == Close || slot.failed)
+					finish(s);
+				else if (step == Read)
+				{
+					if (slot.offset < slot.size)
+						queueRead(s);
+					else
+						finish(s);
+				}
+				else
+				{
+					// both open and statx are in
+					slot.size = (size_t)slot.stat.stx_size;
+					slot.data = (unsigned char*)malloc(slot.size ? slot.size : 1);
+					if (!slot.data)
+					{
+						slot.failed = true;
+						finish(s);
+					}
+					else if (slot.size == 0)
+						finish(s);
+					else
+						queueRead(s);
+				}
+			}
+		}
+	}
+}
+#endif
+
+bool BatchReader::isBatched()
+{
+#ifdef __linux__
+	static const bool supported = ringSupported();
+	return supported;
+#else
+	return false;
+#endif
+}
+
+int BatchReader::readAll(const std::vector<std::string>& paths, const std::function<void(int index, unsigned char* data, size_t size)>& onRead)
+{
+	TRACE_SCOPE("BatchReader::readAll", "io");
+	int read = 0;
+#ifdef __linux__
+	if (isBatched() && readWithRing(paths, onRead, read))
+		return read;
+#endif
+	for (size_t i = 0; i < paths.size(); ++i)
+	{
+		size_t size;
+		unsigned char* data = loadFileBytes(paths[i].c_str(), &size);
+		if (!data)
+			continue;
+		onRead((int)i, data, size);
+		++read;
+	}
+	return read;
+}
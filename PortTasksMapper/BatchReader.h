@@ -0,0 +1,28 @@
+#ifndef BATCHREADER_H
+#define BATCHREADER_H
+
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Reads many small files with as few syscalls as the platform allows. On
+// Linux the opens, sizes, reads and closes of up to IN_FLIGHT files are
+// queued on one io_uring and submitted together; elsewhere, or when the
+// kernel refuses io_uring, it falls back to loadFileBytes per file.
+class BatchReader
+{
+public:
+	static const int IN_FLIGHT = 32;
+
+	// whether readAll batches at all; without it callers are better off
+	// reading files in parallel themselves
+	static bool isBatched();
+
+	// onRead runs on the calling thread as each file completes (in completion
+	// order, not path order) and takes ownership of the malloc'd buffer.
+	// Missing or unreadable files are skipped. Returns the number read.
+	static int readAll(const std::vector<std::string>& paths, const std::function<void(int index, unsigned char* data, size_t size)>& onRead);
+};
+
+#endif // BATCHREADER_H
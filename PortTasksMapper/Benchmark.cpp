@@ -0,0 +1,366 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Benchmark.h"
+#include "MapLoader.h"
+#include "PackedRegion.h"
+#include "TerrainMesh.h"
+#include "Underlay.h"
+#include "Utils.h"
+#include "Xtea.h"
+
+namespace
+{
+	// results are folded in here so the optimizer cannot drop the work
+	std::atomic<unsigned long long> sink(0);
+
+	Tile*** generateRegion(int regionX, int regionY, std::mt19937& rng)
+	{
+		// an empty buffer decodes to four planes of zeroed tiles
+		Tile*** tiles = MapLoader::loadTerrain(nullptr, 0);
+		std::uniform_int_distribution<int> percent(0, 99);
+		std::uniform_int_distribution<int> noise(0, 7);
+
+		for (int x = 0; x < 64; ++x)
+		{
+			for (int y = 0; y < 64; ++y)
+			{
+				int worldX = regionX * 64 + x;
+				int worldY = regionY * 64 + y;
+				Tile& tile = tiles[0][x][y];
+
+				double relief = std::sin(worldX * 0.05) * std::cos(worldY * 0.07) + 0.5 * std::sin((worldX + worldY) * 0.013);
+				tile.height = std::max(1, (int)(60 + 40 * relief) + noise(rng));
+				// patches of one underlay, like painted terrain
+				tile.underlayId = (short)underlayColors[((worldX / 8) * 31 + (worldY / 8) * 17) % underlayColorsCount].id;
+
+				if (relief < -0.6)
+				{
+					tile.overlayId = (short)waterOverlayIds[(worldX / 16 + worldY / 16) % waterOverlayIdsCount];
+					tile.attrOpcode = 2;
+				}
+				else if (percent(rng) < 3)
+				{
+					tile.overlayId = (short)overlayColors[percent(rng) % overlayColorsCount].id;
+					tile.attrOpcode = 2 + 4 * (percent(rng) % 12) + (percent(rng) & 3);
+					tile.overlayPath = (unsigned char)((tile.attrOpcode - 2) / 4);
+					tile.overlayRotation = (unsigned char)((tile.attrOpcode - 2) & 3);
+				}
+				if (percent(rng) < 2)
+					tile.settings = 1;
+
+				// sparse upper floors
+				for (int z = 1; z < 4; ++z)
+				{
+					if (percent(rng) < 5)
+					{
+						tiles[z][x][y].underlayId = tile.underlayId;
+						tiles[z][x][y].height = noise(rng);
+					}
+				}
+			}
+		}
+		return tiles;
+	}
+
+	// a few hundred objects per region, clustered on a small set of ids like real scenery
+	void generateObjects(std::mt19937& rng, RegionObjects& out)
+	{
+		std::uniform_int_distribution<int> count(200, 600);
+		std::uniform_int_distribution<int> id(0, 50000);
+		std::uniform_int_distribution<int> position(0, 0x3FFF);
+		std::uniform_int_distribution<int> type(0, 22);
+		std::uniform_int_distribution<int> orientation(0, 3);
+
+		out.clear();
+		int objects = count(rng);
+		int common[16];
+		for (int& c : common)
+			c = id(rng);
+		for (int i = 0; i < objects; ++i)
+		{
+			out.ids.push_back(i % 3 ? common[i % 16] : id(rng));
+			out.positions.push_back((uint16_t)position(rng));
+			out.shapes.push_back((uint8_t)(type(rng) << 2 | orientation(rng)));
+		}
+	}
+
+	void writeResults(FILE* out, const char* mapFile, int syntheticRegions, int threads, const std::vector<BenchResult>& results)
+	{
+		fprintf(out, "{\n\"file\":\"%s\",\"syntheticRegions\":%d,\"threads\":%d,\n\"results\":[", mapFile, syntheticRegions, threads);
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const BenchResult& r = results[i];
+			double nsPerOp = r.ops ? r.totalMs * 1e6 / r.ops : 0;
+			fprintf(out, "%s\n{\"name\":\"%s\",\"ops\":%lld,\"totalMs\":%.3f,\"nsPerOp\":%.2f",
+				i ? "," : "", r.name.c_str(), r.ops, r.totalMs, nsPerOp);
+			if (r.bytesPerOp > 0)
+				fprintf(out, ",\"mbPerSec\":%.1f", r.bytesPerOp * r.ops / (r.totalMs * 1e3));
+			fprintf(out, "}");
+		}
+		fprintf(out, "\n]}\n");
+	}
+}
+
+void Benchmark::measure(const std::string& name, long long opsPerCall, const std::function<void()>& body, double bytesPerOp)
+{
+	body(); // warm caches and lazily built tables
+
+	long long calls = 0;
+	auto start = std::chrono::steady_clock::now();
+	double elapsedMs = 0;
+	do
+	{
+		body();
+		++calls;
+		elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	} while (elapsedMs < minSeconds * 1000.0);
+
+	results.push_back({ name, calls * opsPerCall, elapsedMs, bytesPerOp });
+	fprintf(stderr, "%-28s %10.1f ns/op\n", name.c_str(), elapsedMs * 1e6 / (calls * opsPerCall));
+}
+
+int Benchmark::runCommand(int argc, char** argv)
+{
+	const char* mapFile = "m50_50.dat";
+	const char* outPath = nullptr;
+	int syntheticRegions = 256;
+	double minSeconds = 0.5;
+	int threads = defaultThreadCount();
+
+	for (int i = 2; i + 1 < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--map"))
+			mapFile = argv[++i];
+		else if (!strcmp(argv[i], "--out"))
+			outPath = argv[++i];
+		else if (!strcmp(argv[i], "--regions"))
+			syntheticRegions = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--seconds"))
+			minSeconds = std::max(0.01, atof(argv[++i]));
+		else if (!strcmp(argv[i], "--threads"))
+			threads = std::max(1, atoi(argv[++i]));
+	}
+
+	size_t mapSize;
+	unsigned char* mapBytes = loadFileBytes(mapFile, &mapSize);
+	if (!mapBytes)
+	{
+		fprintf(stderr, "usage: %s --bench [--map m50_50.dat] [--out file] [--regions n] [--seconds s] [--threads n]\n", argv[0]);
+		return 2;
+	}
+	Tile*** real = MapLoader::loadTerrain(mapBytes, mapSize);
+
+	// a square block of synthetic regions, stored encoded like real map files
+	std::mt19937 rng(1234);
+	int side = (int)std::ceil(std::sqrt((double)syntheticRegions));
+	std::vector<Tile***> synthetic;
+	std::vector<std::vector<unsigned char>> encoded(syntheticRegions);
+	size_t encodedBytes = 0;
+	for (int i = 0; i < syntheticRegions; ++i)
+	{
+		synthetic.push_back(generateRegion(i % side, i / side, rng));
+		MapLoader::encodeTerrain(synthetic.back(), encoded[i]);
+		encodedBytes += encoded[i].size();
+	}
+
+	Benchmark bench(minSeconds);
+
+	// decode
+	bench.measure("decode/m50_50", 1, [&]()
+	{
+		Tile*** tiles = MapLoader::loadTerrain(mapBytes, mapSize);
+		sink += tiles[0][10][10].height;
+		MapLoader::freeTerrain(tiles);
+	}, (double)mapSize);
+
+	bench.measure("decode/synthetic", syntheticRegions, [&]()
+	{
+		for (const std::vector<unsigned char>& bytes : encoded)
+		{
+			Tile*** tiles = MapLoader::loadTerrain(bytes.data(), bytes.size());
+			sink += tiles[0][10][10].height;
+			MapLoader::freeTerrain(tiles);
+		}
+	}, (double)encodedBytes / syntheticRegions);
+
+	bench.measure("decode/synthetic_parallel", syntheticRegions, [&]()
+	{
+		parallelFor(syntheticRegions, threads, [&](int i)
+		{
+			Tile*** tiles = MapLoader::loadTerrain(encoded[i].data(), encoded[i].size());
+			sink += tiles[0][10][10].height;
+			MapLoader::freeTerrain(tiles);
+		});
+	}, (double)encodedBytes / syntheticRegions);
+
+	// objects: encrypted l files, decrypted and decoded the way the streamer does
+	const XteaKey key = { { 0x1234567, -0x2345678, 0x3456789, -0x456789A } };
+	std::vector<std::vector<unsigned char>> locFiles(syntheticRegions);
+	size_t locBytes = 0;
+	for (int i = 0; i < syntheticRegions; ++i)
+	{
+		RegionObjects objects;
+		generateObjects(rng, objects);
+		MapLoader::encodeLocations(objects, locFiles[i]);
+		xteaEncipher(locFiles[i].data(), locFiles[i].size(), key);
+		locBytes += locFiles[i].size();
+	}
+
+	bench.measure("decode/locs_xtea", syntheticRegions, [&]()
+	{
+		std::vector<unsigned char> buf;
+		RegionObjects objects;
+		for (const std::vector<unsigned char>& file : locFiles)
+		{
+			buf.assign(file.begin(), file.end());
+			xteaDecipher(buf.data(), buf.size(), key);
+			MapLoader::loadLocations(buf.data(), buf.size(), objects);
+			sink += objects.size();
+		}
+	}, (double)locBytes / syntheticRegions);
+
+	// packed resident tiles: packing cost, then random reads against the unpacked arrays
+	bench.measure("packed/pack", syntheticRegions, [&]()
+	{
+		size_t bytes = 0;
+		for (Tile*** tiles : synthetic)
+			bytes += PackedRegion(tiles).memoryBytes();
+		sink += bytes;
+	});
+
+	std::vector<PackedRegion> packed;
+	size_t packedBytes = 0;
+	for (Tile*** tiles : synthetic)
+	{
+		packed.emplace_back(tiles);
+		packedBytes += packed.back().memoryBytes();
+	}
+	fprintf(stderr, "packed synthetic regions: %zu bytes each vs %zu unpacked\n", packedBytes / syntheticRegions, MapLoader::terrainBytes());
+
+	std::vector<unsigned int> lookups(1 << 16);
+	std::uniform_int_distribution<unsigned int> anyTile(0, 0xFFFFFFFF);
+	for (unsigned int& lookup : lookups)
+		lookup = anyTile(rng);
+
+	bench.measure("packed/tile_random", (long long)lookups.size(), [&]()
+	{
+		int total = 0;
+		for (unsigned int lookup : lookups)
+			total += packed[lookup % syntheticRegions].tile(lookup >> 12 & 3, lookup >> 6 & 63, lookup & 63).height;
+		sink += total;
+	});
+
+	bench.measure("unpacked/tile_random", (long long)lookups.size(), [&]()
+	{
+		int total = 0;
+		for (unsigned int lookup : lookups)
+			total += synthetic[lookup % syntheticRegions][lookup >> 12 & 3][lookup >> 6 & 63][lookup & 63].height;
+		sink += total;
+	});
+
+	// colour lookups, with the id mix of real and synthetic plane 0
+	std::vector<int> underlayIds, overlayIds;
+	for (Tile*** tiles : { real, synthetic[0] })
+	{
+		for (int x = 0; x < 64; ++x)
+		{
+			for (int y = 0; y < 64; ++y)
+			{
+				underlayIds.push_back(tiles[0][x][y].underlayId);
+				if (tiles[0][x][y].overlayId != 0)
+					overlayIds.push_back(tiles[0][x][y].overlayId);
+			}
+		}
+	}
+	if (overlayIds.empty())
+		overlayIds.push_back(overlayColors[0].id);
+
+	bench.measure("color/underlay", (long long)underlayIds.size(), [&]()
+	{
+		float sum = 0;
+		for (int id : underlayIds)
+			sum += getUnderlayRGB(id).g;
+		sink += (unsigned long long)sum;
+	});
+
+	bench.measure("color/overlay", (long long)overlayIds.size(), [&]()
+	{
+		float sum = 0;
+		for (int id : overlayIds)
+			sum += getOverlayRGB(id).g;
+		sink += (unsigned long long)sum;
+	});
+
+	// meshing (uploadTileMesh minus the GL upload)
+	static float heights[TerrainMesh::SIZE + 1][TerrainMesh::SIZE + 1];
+	std::vector<Vertex> verts;
+
+	bench.measure("mesh/smooth_heights", 1, [&]()
+	{
+		TerrainMesh::smoothHeights(real, heights);
+		sink += (unsigned long long)heights[32][32];
+	});
+
+	bench.measure("mesh/build_vertices", 1, [&]()
+	{
+		TerrainMesh::buildVertices(real, heights, nullptr, verts);
+		sink += verts.size();
+	}, (double)(TerrainMesh::SIZE * TerrainMesh::SIZE * 6 * sizeof(Vertex)));
+
+	bench.measure("mesh/synthetic", syntheticRegions, [&]()
+	{
+		for (Tile*** tiles : synthetic)
+		{
+			TerrainMesh::smoothHeights(tiles, heights);
+			TerrainMesh::buildVertices(tiles, heights, nullptr, verts);
+			sink += verts.size();
+		}
+	});
+
+	// picking: random cursor positions under the default camera
+	glm::vec3 target(31.0f, 0.0f, 31.0f);
+	glm::vec3 eye = target + glm::vec3(0.0f, 180.0f * std::sin(glm::radians(45.0f)), 180.0f * std::cos(glm::radians(45.0f)));
+	glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+	glm::mat4 projection = glm::perspective(glm::radians(50.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	std::vector<glm::vec2> cursors(4096);
+	std::uniform_real_distribution<float> ndc(-1.0f, 1.0f);
+	for (glm::vec2& c : cursors)
+		c = glm::vec2(ndc(rng), ndc(rng));
+
+	bench.measure("pick/ray", (long long)cursors.size(), [&]()
+	{
+		int total = 0;
+		for (const glm::vec2& c : cursors)
+		{
+			int tileX, tileY;
+			TerrainMesh::hitToTile(TerrainMesh::intersectGround(eye, TerrainMesh::rayFromScreen(c.x, c.y, view, projection)), tileX, tileY);
+			total += tileX + tileY;
+		}
+		sink += total;
+	});
+
+	FILE* out = outPath ? fopen(outPath, "w") : stdout;
+	if (!out)
+	{
+		fprintf(stderr, "Failed to open %s\n", outPath);
+		return 2;
+	}
+	writeResults(out, mapFile, syntheticRegions, threads, bench.getResults());
+	if (out != stdout)
+		fclose(out);
+
+	for (Tile*** tiles : synthetic)
+		MapLoader::freeTerrain(tiles);
+	MapLoader::freeTerrain(real);
+	free(mapBytes);
+	return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+struct BenchResult
+{
+	std::string name;
+	long long ops;
+	double totalMs;
+	double bytesPerOp;
+};
+
+// Times the CPU hot paths (region and object decode, colour table lookups, mesh
+// building, ray picking) on m50_50.dat and on a generated world of
+// synthetic regions, and reports every case as JSON so runs can be diffed.
+class Benchmark
+{
+public:
+	explicit Benchmark(double minSeconds) : minSeconds(minSeconds) {}
+
+	// Repeats body (which performs opsPerCall operations) until minSeconds have passed.
+	void measure(const std::string& name, long long opsPerCall, const std::function<void()>& body, double bytesPerOp = 0);
+	const std::vector<BenchResult>& getResults() const { return results; }
+
+	// Entry point for the headless --bench mode.
+	static int runCommand(int argc, char** argv);
+
+private:
+	double minSeconds;
+	std::vector<BenchResult> results;
+};
+
+#endif // BENCHMARK_H
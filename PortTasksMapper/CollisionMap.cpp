@@ -0,0 +1,143 @@
+#include "CollisionMap.h"
+#include "Underlay.h"
+#include "Utils.h"
+
+namespace
+{
+	const int N = WorldMap::REGION_SIZE;
+
+	// loc types whose tile is solid: diagonal walls and centrepiece objects.
+	// Object sizes and the non-solid flag live in the loc definitions, which
+	// are not loaded, so every such object blocks just its own tile.
+	bool isSolidShape(int type)
+	{
+		return type == 9 || type == 10 || type == 11;
+	}
+
+	// sides covered by a wall loc: a straight wall (0) stands on the side its
+	// orientation names, an L-shaped corner (2) on that side and the next
+	int wallSides(int type, int orientation)
+	{
+		if (type == 0)
+			return 1 << orientation;
+		if (type == 2)
+			return 1 << orientation | 1 << ((orientation + 1) & 3);
+		return 0;
+	}
+}
+
+void CollisionMap::fillGrid(Tile*** tiles, const RegionObjects* objects, RegionGrid& grid)
+{
+	grid.blocked.fill(0);
+	for (PlaneBits& side : grid.walls)
+		side.fill(0);
+
+	auto collisionPlane = [tiles](int plane, int x, int y)
+	{
+		return (tiles[1][x][y].settings & TILE_BRIDGE) ? plane - 1 : plane;
+	};
+
+	for (int plane = 0; plane < 4; ++plane)
+	{
+		for (int x = 0; x < N; ++x)
+		{
+			for (int y = 0; y < N; ++y)
+			{
+				const Tile& tile = tiles[plane][x][y];
+				if (!(tile.settings & TILE_BLOCKED) && !isWaterOverlay(tile.overlayId))
+					continue;
+				int target = collisionPlane(plane, x, y);
+				if (target >= 0)
+					grid.blocked[target * N + x] |= 1ull << y;
+			}
+		}
+	}
+
+	if (!objects)
+		return;
+	for (size_t i = 0; i < objects->size(); ++i)
+	{
+		int type = RegionObjects::type(objects->shapes[i]);
+		int sides = wallSides(type, RegionObjects::orientation(objects->shapes[i]));
+		if (!sides && !isSolidShape(type))
+			continue;
+		uint16_t position = objects->positions[i];
+		int x = RegionObjects::localX(position);
+		int y = RegionObjects::localY(position);
+		int target = collisionPlane(RegionObjects::plane(position), x, y);
+		if (target < 0)
+			continue;
+		if (isSolidShape(type))
+			grid.blocked[target * N + x] |= 1ull << y;
+		for (int side = 0; side < 4; ++side)
+			if (sides & 1 << side)
+				grid.walls[side][target * N + x] |= 1ull << y;
+	}
+}
+
+void CollisionMap::build(const WorldMap& world, int threads)
+{
+	std::vector<int> regionIds;
+	for (const auto& region : world.regions())
+		regionIds.push_back(region.first);
+
+	// the map is filled up front so workers only write their own grid
+	grids.clear();
+	std::vector<RegionGrid*> slots;
+	for (int id : regionIds)
+		slots.push_back(&grids[id]);
+
+	parallelFor((int)regionIds.size(), threads, [&](int i)
+	{
+		int rx = WorldMap::regionX(regionIds[i]);
+		int ry = WorldMap::regionY(regionIds[i]);
+		fillGrid(world.getRegion(rx, ry), world.getObjects(rx, ry), *slots[i]);
+	});
+}
+
+void CollisionMap::buildRegion(const WorldMap& world, int regionX, int regionY)
+{
+	Tile*** tiles = world.getRegion(regionX, regionY);
+	if (!tiles)
+	{
+		grids.erase(WorldMap::regionId(regionX, regionY));
+		return;
+	}
+	fillGrid(tiles, world.getObjects(regionX, regionY), grids[WorldMap::regionId(regionX, regionY)]);
+}
+
+const CollisionMap::RegionGrid* CollisionMap::gridAt(int x, int y, int plane) const
+{
+	if (x < 0 || y < 0 || plane < 0 || plane > 3)
+		return nullptr;
+	auto it = grids.find(WorldMap::regionId(x / N, y / N));
+	return it == grids.end() ? nullptr : &it->second;
+}
+
+bool CollisionMap::isBlocked(int x, int y, int plane) const
+{
+	const RegionGrid* grid = gridAt(x, y, plane);
+	if (!grid)
+		return true;
+	return (grid->blocked[plane * N + x % N] >> (y % N) & 1) != 0;
+}
+
+bool CollisionMap::hasWall(int x, int y, int plane, WallSide side) const
+{
+	const RegionGrid* grid = gridAt(x, y, plane);
+	return grid && (grid->walls[side][plane * N + x % N] >> (y % N) & 1) != 0;
+}
+
+bool CollisionMap::canStep(int x, int y, int plane, int dx, int dy) const
+{
+	WallSide leaving = dx < 0 ? WALL_WEST : dx > 0 ? WALL_EAST : dy > 0 ? WALL_NORTH : WALL_SOUTH;
+	WallSide entering = (WallSide)((leaving + 2) & 3);
+	return isWalkable(x + dx, y + dy, plane)
+		&& !hasWall(x, y, plane, leaving)
+		&& !hasWall(x + dx, y + dy, plane, entering);
+}
+
+size_t CollisionMap::memoryBytes() const
+{
+	return grids.size() * sizeof(RegionGrid);
+}
@@ -0,0 +1,52 @@
+#ifndef COLLISIONMAP_H
+#define COLLISIONMAP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include "WorldMap.h"
+
+// Blocked tiles of every loaded region as packed bits, one 64-bit word per
+// (plane, x) column with bit y set when the tile is blocked. A tile is
+// blocked by its settings, by water, or by a solid object on it. Walls
+// (loc types 0 and 2) leave their tile walkable and instead set a bit for
+// each side they stand on, which stops steps across that edge. Corner
+// posts (types 1 and 3) only stop diagonal steps through the corner and
+// are not tracked. Tiles under a bridge (plane 1 bridge flag) take their
+// collision from the plane above, as the client does. Unloaded tiles count
+// as blocked.
+class CollisionMap
+{
+public:
+	// tile sides, in loc orientation order
+	enum WallSide { WALL_WEST, WALL_NORTH, WALL_EAST, WALL_SOUTH };
+
+	void build(const WorldMap& world, int threads);
+	// (re)builds one region from its tiles and objects; clears it if not loaded
+	void buildRegion(const WorldMap& world, int regionX, int regionY);
+
+	bool isBlocked(int x, int y, int plane) const;
+	bool isWalkable(int x, int y, int plane) const { return !isBlocked(x, y, plane); }
+	bool hasWall(int x, int y, int plane, WallSide side) const;
+	// one cardinal step (dx or dy of +-1): the target is walkable and no wall
+	// on either tile stands on the edge between them
+	bool canStep(int x, int y, int plane, int dx, int dy) const;
+	bool hasRegion(int regionX, int regionY) const { return grids.count(WorldMap::regionId(regionX, regionY)) != 0; }
+	size_t memoryBytes() const;
+
+private:
+	typedef std::array<uint64_t, 4 * WorldMap::REGION_SIZE> PlaneBits;
+	struct RegionGrid
+	{
+		PlaneBits blocked;
+		PlaneBits walls[4];
+	};
+
+	static void fillGrid(Tile*** tiles, const RegionObjects* objects, RegionGrid& grid);
+	const RegionGrid* gridAt(int x, int y, int plane) const;
+
+	std::unordered_map<int, RegionGrid> grids;
+};
+
+#endif // COLLISIONMAP_H
@@ -0,0 +1,210 @@
+#include "EditHistory.h"
+
+namespace
+{
+	unsigned int pack(const WorldPoint& p)
+	{
+		return (unsigned int)(p.x & 0x3FFF) | (unsigned int)(p.y & 0x3FFF) << 14 | (unsigned int)(p.plane & 0x3) << 28;
+	}
+
+	WorldPoint unpack(unsigned int v)
+	{
+		return { (int)(v & 0x3FFF), (int)(v >> 14 & 0x3FFF), (int)(v >> 28 & 0x3) };
+	}
+}
+
+static_assert(sizeof(Edit) == 16, "Edit should stay a 16 byte delta");
+
+EditHistory::EditHistory(PathSet& paths, WorldMap& world)
+	: paths(paths), world(world)
+{
+}
+
+void EditHistory::appendPoint(const WorldPoint& point)
+{
+	int path = paths.getActiveIndex();
+	insertPoint(path, (int)paths.paths()[path].points.size(), point);
+}
+
+void EditHistory::insertPoint(int path, int index, const WorldPoint& point)
+{
+	record({ EditType::PointInsert, TileField::Height, (unsigned short)path, (unsigned int)index, 0, pack(point) });
+}
+
+void EditHistory::erasePoint(int path, int index)
+{
+	const WorldPoint& old = paths.paths()[path].points[index];
+	record({ EditType::PointErase, TileField::Height, (unsigned short)path, (unsigned int)index, pack(old), 0 });
+}
+
+void EditHistory::movePoint(int path, int index, const WorldPoint& point)
+{
+	const WorldPoint& old = paths.paths()[path].points[index];
+	if (old == point)
+		return;
+	record({ EditType::PointMove, TileField::Height, (unsigned short)path, (unsigned int)index, pack(old), pack(point) });
+}
+
+void EditHistory::movePoint(int path, int index, const WorldPoint& from, const WorldPoint& to)
+{
+	if (from == to)
+		return;
+	record({ EditType::PointMove, TileField::Height, (unsigned short)path, (unsigned int)index, pack(from), pack(to) });
+}
+
+void EditHistory::replacePoints(int path, const std::vector<WorldPoint>& points)
+{
+	const Path& old = paths.paths()[path];
+	unsigned int before = storeSnapshot(old);
+	unsigned int after = storeSnapshot({ old.name, points });
+	record({ EditType::PathReplace, TileField::Height, (unsigned short)path, 0, before, after });
+}
+
+void EditHistory::addPath(const std::string& name, const std::vector<WorldPoint>& points)
+{
+	unsigned int after = storeSnapshot({ name, points });
+	record({ EditType::PathAdd, TileField::Height, (unsigned short)paths.paths().size(), 0, 0, after });
+}
+
+void EditHistory::setTileField(int x, int y, int plane, TileField field, int value)
+{
+	Tile tile;
+	if (!world.tileAt(x, y, plane, tile))
+		return;
+
+	int old = getTileField(tile, field);
+	if (old == value)
+		return;
+	record({ EditType::TileChange, field, 0, pack({ x, y, plane }), (unsigned int)old, (unsigned int)value });
+}
+
+void EditHistory::record(const Edit& edit)
+{
+	// a new edit discards whatever could have been redone
+	while (edits.size() > cursor)
+	{
+		releaseSnapshots(edits.back());
+		edits.pop_back();
+	}
+
+	apply(edit, true);
+	edits.push_back(edit);
+	++cursor;
+
+	if (edits.size() > MAX_EDITS)
+	{
+		releaseSnapshots(edits.front());
+		edits.pop_front();
+		--cursor;
+	}
+}
+
+bool EditHistory::undo()
+{
+	if (!canUndo())
+		return false;
+	apply(edits[--cursor], false);
+	return true;
+}
+
+bool EditHistory::redo()
+{
+	if (!canRedo())
+		return false;
+	apply(edits[cursor++], true);
+	return true;
+}
+
+void EditHistory::apply(const Edit& edit, bool forward)
+{
+	switch (edit.type)
+	{
+	case EditType::PointInsert:
+		if (forward)
+			paths.insertPoint(edit.path, edit.index, unpack(edit.after));
+		else
+			paths.erasePoint(edit.path, edit.index);
+		break;
+	case EditType::PointErase:
+		if (forward)
+			paths.erasePoint(edit.path, edit.index);
+		else
+			paths.insertPoint(edit.path, edit.index, unpack(edit.before));
+		break;
+	case EditType::PointMove:
+		paths.setPoint(edit.path, edit.index, unpack(forward ? edit.after : edit.before));
+		break;
+	case EditType::PathReplace:
+		paths.setPoints(edit.path, snapshots[forward ? edit.after : edit.before].points);
+		break;
+	case EditType::PathAdd:
+		if (forward)
+		{
+			const Path& added = snapshots[edit.after];
+			paths.addPath(added.name);
+			paths.setPoints(edit.path, added.points);
+		}
+		else
+		{
+			paths.removePath(edit.path);
+		}
+		break;
+	case EditType::TileChange:
+	{
+		WorldPoint p = unpack(edit.index);
+		Tile tile;
+		if (!world.tileAt(p.x, p.y, p.plane, tile))
+			break;
+		setTileField(tile, edit.field, (int)(forward ? edit.after : edit.before));
+		world.setTile(p.x, p.y, p.plane, tile);
+		if (onTileChanged)
+			onTileChanged(p.x, p.y, p.plane);
+		break;
+	}
+	}
+}
+
+unsigned int EditHistory::storeSnapshot(const Path& path)
+{
+	snapshots[nextSnapshot] = path;
+	return nextSnapshot++;
+}
+
+void EditHistory::releaseSnapshots(const Edit& edit)
+{
+	if (edit.type == EditType::PathReplace)
+		snapshots.erase(edit.before);
+	if (edit.type == EditType::PathReplace || edit.type == EditType::PathAdd)
+		snapshots.erase(edit.after);
+}
+
+size_t EditHistory::memoryBytes() const
+{
+	size_t bytes = edits.size() * sizeof(Edit);
+	for (const auto& entry : snapshots)
+		bytes += sizeof(Path) + entry.second.name.capacity() + entry.second.points.capacity() * sizeof(WorldPoint);
+	return bytes;
+}
+
+int EditHistory::getTileField(const Tile& tile, TileField field)
+{
+	switch (field)
+	{
+	case TileField::Height: return tile.height;
+	case TileField::Settings: return tile.settings;
+	case TileField::OverlayId: return tile.overlayId;
+	case TileField::UnderlayId: return tile.underlayId;
+	}
+	return 0;
+}
+
+void EditHistory::setTileField(Tile& tile, TileField field, int value)
+{
+	switch (field)
+	{
+	case TileField::Height: tile.height = value; break;
+	case TileField::Settings: tile.settings = (unsigned char)value; break;
+	case TileField::OverlayId: tile.overlayId = (short)value; break;
+	case TileField::UnderlayId: tile.underlayId = (short)value; break;
+	}
+}
@@ -0,0 +1,90 @@
+#ifndef EDITHISTORY_H
+#define EDITHISTORY_H
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include "Path.h"
+#include "WorldMap.h"
+
+enum class EditType : unsigned char
+{
+	PointInsert,
+	PointErase,
+	PointMove,
+	PathReplace,
+	PathAdd,
+	TileChange
+};
+
+enum class TileField : unsigned char
+{
+	Height,
+	Settings,
+	OverlayId,
+	UnderlayId
+};
+
+// One undoable change, stored as a 16 byte delta. Points and tile
+// coordinates are packed as x | y << 14 | plane << 28. Bulk changes (a whole
+// path replaced by a route or simplification) refer to snapshots instead of
+// recording one delta per point.
+struct Edit
+{
+	EditType type;
+	TileField field;
+	unsigned short path;
+	unsigned int index;
+	unsigned int before;
+	unsigned int after;
+};
+
+// Undo/redo log for path and terrain edits. Every edit goes through here so
+// it can be reversed; undo and redo apply one stored delta each.
+class EditHistory
+{
+public:
+	static const size_t MAX_EDITS = 1 << 16;
+
+	EditHistory(PathSet& paths, WorldMap& world);
+
+	void appendPoint(const WorldPoint& point);
+	void insertPoint(int path, int index, const WorldPoint& point);
+	void erasePoint(int path, int index);
+	void movePoint(int path, int index, const WorldPoint& point);
+	// records a move that was previewed live (e.g. while dragging), so undo
+	// returns to `from` rather than to the last preview position
+	void movePoint(int path, int index, const WorldPoint& from, const WorldPoint& to);
+	void replacePoints(int path, const std::vector<WorldPoint>& points);
+	void addPath(const std::string& name, const std::vector<WorldPoint>& points);
+	void setTileField(int x, int y, int plane, TileField field, int value);
+
+	bool undo();
+	bool redo();
+	bool canUndo() const { return cursor > 0; }
+	bool canRedo() const { return cursor < edits.size(); }
+	size_t size() const { return edits.size(); }
+	size_t memoryBytes() const;
+
+	static int getTileField(const Tile& tile, TileField field);
+	static void setTileField(Tile& tile, TileField field, int value);
+
+	// called after a tile edit is applied, undone or redone
+	std::function<void(int x, int y, int plane)> onTileChanged;
+
+private:
+	void record(const Edit& edit);
+	void apply(const Edit& edit, bool forward);
+	unsigned int storeSnapshot(const Path& path);
+	void releaseSnapshots(const Edit& edit);
+
+	PathSet& paths;
+	WorldMap& world;
+	std::deque<Edit> edits;
+	size_t cursor = 0;
+	std::unordered_map<unsigned int, Path> snapshots;
+	unsigned int nextSnapshot = 0;
+};
+
+#endif // EDITHISTORY_H
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <chrono>
+#include <glad/glad.h>
+#include "FrameProfiler.h"
+#include "imgui.h"
+
+namespace {
+	const int STAGES = (int)FrameStage::Count;
+	const int HISTORY = 120;
+	const char* stageNames[STAGES] = { "Input", "Picking", "Terrain", "Overlay", "UI build", "UI render", "Swap" };
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct FrameStats {
+		float cpuMs[STAGES] = {};
+		float gpuMs[STAGES] = {};
+		float frameMs = 0;
+		int drawCalls = 0;
+		int vertices = 0;
+		int uploads = 0;
+		size_t uploadBytes = 0;
+	};
+
+	GLuint queries[2][STAGES] = {};
+	bool issued[2][STAGES] = {};
+	bool queryOpen = false;
+	int frameIndex = 0;
+
+	Clock::time_point frameStart;
+	Clock::time_point stageStart[STAGES];
+	float cpuMs[STAGES] = {};
+
+	// smoothed for display, plus the raw frame time history
+	FrameStats average;
+	FrameStats last;
+	float frameHistory[HISTORY] = {};
+	int historyPos = 0;
+
+	float msSince(Clock::time_point start) {
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+
+	void blend(float& average, float value) {
+		average += (value - average) * 0.1f;
+	}
+}
+
+void FrameProfiler::init() {
+	glGenQueries(2 * STAGES, &queries[0][0]);
+}
+
+void FrameProfiler::cleanup() {
+	if (queries[0][0])
+		glDeleteQueries(2 * STAGES, &queries[0][0]);
+	std::fill(&queries[0][0], &queries[0][0] + 2 * STAGES, 0u);
+}
+
+void FrameProfiler::beginFrame() {
+	frameStart = Clock::now();
+	std::fill(cpuMs, cpuMs + STAGES, 0.0f);
+	drawCalls = 0;
+	vertexCount = 0;
+	uploads = 0;
+	uploadBytes = 0;
+}
+
+void FrameProfiler::beginStage(FrameStage stage) {
+	int s = (int)stage;
+	stageStart[s] = Clock::now();
+	if (enabled && queries[0][0] && !queryOpen) {
+		glBeginQuery(GL_TIME_ELAPSED, queries[frameIndex & 1][s]);
+		issued[frameIndex & 1][s] = true;
+		queryOpen = true;
+	}
+}
+
+void FrameProfiler::endStage(FrameStage stage) {
+	int s = (int)stage;
+	cpuMs[s] += msSince(stageStart[s]);
+	// closed even if the panel was toggled off inside the stage
+	if (queryOpen) {
+		glEndQuery(GL_TIME_ELAPSED);
+		queryOpen = false;
+	}
+}
+
+void FrameProfiler::endFrame() {
+	last.frameMs = msSince(frameStart);
+	std::copy(cpuMs, cpuMs + STAGES, last.cpuMs);
+	last.drawCalls = drawCalls;
+	last.vertices = vertexCount;
+	last.uploads = uploads;
+	last.uploadBytes = uploadBytes;
+
+	// the other set was issued a frame ago; its results are normally ready by now
+	int previous = (frameIndex + 1) & 1;
+	for (int s = 0; s < STAGES; ++s) {
+		if (!issued[previous][s])
+			continue;
+		GLint available = 0;
+		glGetQueryObjectiv(queries[previous][s], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v(queries[previous][s], GL_QUERY_RESULT, &ns);
+			last.gpuMs[s] = ns / 1e6f;
+			issued[previous][s] = false;
+		}
+	}
+	++frameIndex;
+
+	for (int s = 0; s < STAGES; ++s) {
+		blend(average.cpuMs[s], last.cpuMs[s]);
+		blend(average.gpuMs[s], last.gpuMs[s]);
+	}
+	blend(average.frameMs, last.frameMs);
+
+	frameHistory[historyPos] = last.frameMs;
+	historyPos = (historyPos + 1) % HISTORY;
+}
+
+void FrameProfiler::drawPanel() {
+	if (!enabled)
+		return;
+
+	ImGui::SetNextWindowPos(ImVec2(570, 150), ImGuiCond_Once);
+	ImGui::SetNextWindowSize(ImVec2(220, 270), ImGuiCond_Once);
+	ImGui::SetNextWindowBgAlpha(0.5f);
+	ImGui::Begin("Profiler", &enabled, ImGuiWindowFlags_NoCollapse);
+
+	ImGui::Text("Frame %.2f ms (%.0f fps)", average.frameMs, average.frameMs > 0 ? 1000.0f / average.frameMs : 0.0f);
+	ImGui::PlotLines("##frames", frameHistory, HISTORY, historyPos, nullptr, 0.0f, 33.3f, ImVec2(-1, 40));
+
+	if (ImGui::BeginTable("##stages", 3, ImGuiTableFlags_SizingStretchProp)) {
+		ImGui::TableSetupColumn("Stage");
+		ImGui::TableSetupColumn("CPU ms");
+		ImGui::TableSetupColumn("GPU ms");
+		ImGui::TableHeadersRow();
+		for (int s = 0; s < STAGES; ++s) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(stageNames[s]);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", average.cpuMs[s]);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", average.gpuMs[s]);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::Text("Draw calls: %d", last.drawCalls);
+	ImGui::Text("Vertices: %d", last.vertices);
+	ImGui::Text("Uploads: %d (%.1f KB)", last.uploads, last.uploadBytes / 1024.0f);
+
+	ImGui::End();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <cstddef>
+
+enum class FrameStage {
+	Input,
+	Picking,
+	Terrain,
+	Overlay,
+	UiBuild,
+	UiRender,
+	Swap,
+	Count
+};
+
+// Per-frame breakdown of the main loop. CPU time comes from scoped timers,
+// GPU time from GL_TIME_ELAPSED queries that are double-buffered so reading
+// last frame's results never stalls. Stages must not nest (GL allows only
+// one elapsed-time query at a time).
+class FrameProfiler {
+public:
+	static void init();
+	static void cleanup();
+
+	static void beginFrame();
+	static void endFrame();
+	static void beginStage(FrameStage stage);
+	static void endStage(FrameStage stage);
+
+	static void countDraw(int vertices) { ++drawCalls; vertexCount += vertices; }
+	static void countUpload(size_t bytes) { ++uploads; uploadBytes += bytes; }
+
+	static void drawPanel();
+
+	class Scope {
+	public:
+		explicit Scope(FrameStage stage) : stage(stage) { beginStage(stage); }
+		~Scope() { endStage(stage); }
+	private:
+		FrameStage stage;
+	};
+
+	static inline bool enabled = false;
+
+private:
+	static inline int drawCalls = 0;
+	static inline int vertexCount = 0;
+	static inline int uploads = 0;
+	static inline size_t uploadBytes = 0;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "GpuUploader.h"
+#include "MapRenderer.h"
+#include "MemoryStats.h"
+#include "Trace.h"
+
+bool GpuUploader::start(GLFWwindow* shareWith) {
+	if (context)
+		return true;
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	context = glfwCreateWindow(1, 1, "uploader", nullptr, shareWith);
+	glfwDefaultWindowHints();
+	if (!context)
+		return false;
+
+	stopping = false;
+	thread = std::thread(&GpuUploader::threadLoop, this);
+	return true;
+}
+
+void GpuUploader::stop() {
+	if (!context)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		stopping = true;
+	}
+	jobReady.notify_all();
+	thread.join();
+
+	// buffers are shared objects, so the main context can free the leftovers
+	Result result;
+	while (finished.pop(result))
+		fenced.push_back(result);
+	for (Result& r : fenced) {
+		glDeleteSync((GLsync)r.fence);
+		glDeleteBuffers(1, &r.buffer);
+		MemoryStats::add(MemoryCategory::GpuBuffers, -(long long)(r.vertices * sizeof(Vertex)));
+	}
+	fenced.clear();
+	for (Job& job : jobs)
+		MemoryStats::add(MemoryCategory::MeshStaging, -(long long)(job.verts.capacity() * sizeof(Vertex)));
+	jobs.clear();
+	outstanding = 0;
+
+	glfwDestroyWindow(context);
+	context = nullptr;
+}
+
+void GpuUploader::upload(int regionX, int regionY, std::vector<Vertex>&& verts) {
+	Job job;
+	job.regionX = regionX;
+	job.regionY = regionY;
+	job.generation = MapRenderer::regionGeneration(regionX, regionY);
+	job.verts = std::move(verts);
+	++outstanding;
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobs.push_back(std::move(job));
+	}
+	jobReady.notify_one();
+}
+
+int GpuUploader::collect() {
+	Result result;
+	while (finished.pop(result))
+		fenced.push_back(result);
+
+	// fences signal in submission order, so stop at the first pending one
+	int adopted = 0;
+	while (!fenced.empty()) {
+		Result& front = fenced.front();
+		GLenum status = glClientWaitSync((GLsync)front.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync((GLsync)front.fence);
+		if (front.generation == MapRenderer::regionGeneration(front.regionX, front.regionY)) {
+			MapRenderer::installRegionMesh(front.regionX, front.regionY, front.buffer, front.vertices);
+			++adopted;
+		}
+		else {
+			glDeleteBuffers(1, &front.buffer);
+			MemoryStats::add(MemoryCategory::GpuBuffers, -(long long)(front.vertices * sizeof(Vertex)));
+		}
+		fenced.pop_front();
+		--outstanding;
+	}
+	return adopted;
+}
+
+void GpuUploader::threadLoop() {
+	Trace::setThreadName("gpu uploader");
+	glfwMakeContextCurrent(context);
+
+	for (;;) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping)
+				break;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		TRACE_SCOPE("backgroundUpload", "gpu");
+		size_t bytes = job.verts.size() * sizeof(Vertex);
+		Result result;
+		result.regionX = job.regionX;
+		result.regionY = job.regionY;
+		result.generation = job.generation;
+		result.vertices = (int)job.verts.size();
+		glGenBuffers(1, &result.buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, result.buffer);
+		glBufferData(GL_ARRAY_BUFFER, bytes, job.verts.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		result.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		// the fence must reach the GPU before another context can wait on it
+		glFlush();
+
+		MemoryStats::add(MemoryCategory::GpuBuffers, (long long)bytes);
+		MemoryStats::add(MemoryCategory::MeshStaging, -(long long)(job.verts.capacity() * sizeof(Vertex)));
+		finished.push(result);
+		MapRenderer::requestRedraw();
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#ifndef GPUUPLOADER_H
+#define GPUUPLOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "MpscQueue.h"
+#include "TerrainMesh.h"
+
+struct GLFWwindow;
+
+// Optional upload thread with its own GL context, shared with the main
+// one. It creates and fills region vertex buffers itself and fences each
+// one; the render thread only adopts buffers whose fence has signalled
+// (VAOs are not shared between contexts, so those are made on adoption).
+class GpuUploader {
+public:
+	GpuUploader() = default;
+	GpuUploader(const GpuUploader&) = delete;
+	GpuUploader& operator=(const GpuUploader&) = delete;
+	~GpuUploader() { stop(); }
+
+	// main thread; creates a hidden window sharing objects with `shareWith`
+	bool start(GLFWwindow* shareWith);
+	// main thread, with the main context current; frees anything not yet adopted
+	void stop();
+	bool isRunning() const { return context != nullptr; }
+
+	void upload(int regionX, int regionY, std::vector<Vertex>&& verts);
+	// hands every upload whose fence has signalled to MapRenderer, dropping
+	// those a synchronous rebuild has superseded; returns how many were adopted
+	int collect();
+	bool isBusy() const { return outstanding > 0; }
+
+private:
+	// generation is MapRenderer::regionGeneration at upload time
+	struct Job {
+		int regionX = 0, regionY = 0;
+		unsigned int generation = 0;
+		std::vector<Vertex> verts;
+	};
+	struct Result {
+		int regionX = 0, regionY = 0;
+		unsigned int generation = 0;
+		unsigned int buffer = 0;
+		int vertices = 0;
+		void* fence = nullptr;
+	};
+
+	void threadLoop();
+
+	GLFWwindow* context = nullptr;
+	std::thread thread;
+	std::mutex jobMutex;
+	std::condition_variable jobReady;
+	std::deque<Job> jobs;
+	bool stopping = false;
+
+	MpscQueue<Result> finished;
+	std::deque<Result> fenced;
+	int outstanding = 0;
+};
+
+#endif
@@ -0,0 +1,320 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "JobSystem.h"
+#include "Trace.h"
+
+namespace
+{
+	struct JobQueue
+	{
+		std::mutex mutex;
+		std::deque<Job*> jobs;
+	};
+
+	std::mutex startMutex;
+	std::vector<std::thread> workers;
+	// one queue per worker, then the shared queue for outside threads
+	std::vector<std::unique_ptr<JobQueue>> queues;
+	std::atomic<bool> running(false);
+	std::atomic<bool> stopping(false);
+	std::atomic<int> queued(0);
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+
+	thread_local int workerIndex = -1;
+
+	JobQueue& sharedQueue()
+	{
+		return *queues.back();
+	}
+
+	Job* popOwn()
+	{
+		JobQueue& queue = workerIndex >= 0 ? *queues[workerIndex] : sharedQueue();
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty())
+			return nullptr;
+		Job* job;
+		if (workerIndex >= 0)
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+		}
+		else
+		{
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+		}
+		return job;
+	}
+
+	Job* steal()
+	{
+		// the shared queue first, then the other workers starting past our own
+		int count = (int)queues.size();
+		int start = workerIndex >= 0 ? workerIndex + 1 : 0;
+		for (int n = 0; n < count; ++n)
+		{
+			int i = (count - 1 + start + n) % count;
+			if (i == workerIndex)
+				continue;
+			JobQueue& queue = *queues[i];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty())
+			{
+				Job* job = queue.jobs.front();
+				queue.jobs.pop_front();
+				return job;
+			}
+		}
+		return nullptr;
+	}
+
+	Job* findJob()
+	{
+		if (queued.load(std::memory_order_acquire) == 0)
+			return nullptr;
+		Job* job = popOwn();
+		if (!job)
+			job = steal();
+		if (job)
+			--queued;
+		return job;
+	}
+
+	bool descendsFrom(const Job* job, const Job* root)
+	{
+		// queued jobs have not finished, so every parent on the chain is alive
+		for (; job; job = job->parent)
+			if (job == root)
+				return true;
+		return false;
+	}
+
+	// Takes a queued job from root's subtree: the newest in our own queue,
+	// else the oldest anywhere else. Waiters only help with their own work so
+	// that, say, a parallelFor on the GL thread never picks up streaming jobs.
+	Job* takeDescendant(const Job& root)
+	{
+		if (queued.load(std::memory_order_acquire) == 0)
+			return nullptr;
+		JobQueue& own = workerIndex >= 0 ? *queues[workerIndex] : sharedQueue();
+		{
+			std::lock_guard<std::mutex> lock(own.mutex);
+			for (auto it = own.jobs.rbegin(); it != own.jobs.rend(); ++it)
+			{
+				if (!descendsFrom(*it, &root))
+					continue;
+				Job* job = *it;
+				own.jobs.erase(std::next(it).base());
+				--queued;
+				return job;
+			}
+		}
+		for (const std::unique_ptr<JobQueue>& queue : queues)
+		{
+			if (queue.get() == &own)
+				continue;
+			std::lock_guard<std::mutex> lock(queue->mutex);
+			for (auto it = queue->jobs.begin(); it != queue->jobs.end(); ++it)
+			{
+				if (!descendsFrom(*it, &root))
+					continue;
+				Job* job = *it;
+				queue->jobs.erase(it);
+				--queued;
+				return job;
+			}
+		}
+		return nullptr;
+	}
+
+	void finish(Job* job)
+	{
+		// read the parent first: once pending hits zero a waiter may free the job
+		while (job)
+		{
+			Job* parent = job->parent;
+			if (job->pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				return;
+			job = parent;
+		}
+	}
+
+	void execute(Job* job)
+	{
+		if (job->work)
+			job->work();
+		finish(job);
+	}
+
+	void workerLoop(int index)
+	{
+		workerIndex = index;
+		Trace::setThreadName(("job worker " + std::to_string(index)).c_str());
+		while (!stopping)
+		{
+			Job* job = findJob();
+			if (job)
+			{
+				execute(job);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wake.wait_for(lock, std::chrono::milliseconds(10), []() { return stopping || queued > 0; });
+		}
+	}
+}
+
+void* ScratchArena::allocate(size_t bytes, size_t alignment)
+{
+	for (;;)
+	{
+		if (chunk < chunks.size())
+		{
+			Chunk& current = chunks[chunk];
+			size_t base = (size_t)current.data.get();
+			size_t aligned = (base + offset + alignment - 1) & ~(alignment - 1);
+			if (aligned + bytes <= base + current.size)
+			{
+				offset = aligned + bytes - base;
+				return (void*)aligned;
+			}
+			if (chunk + 1 < chunks.size())
+			{
+				++chunk;
+				offset = 0;
+				continue;
+			}
+		}
+
+		// oversized requests get a chunk of their own size
+		size_t size = std::max(CHUNK_SIZE, bytes + alignment);
+		chunks.push_back({ std::unique_ptr<char[]>(new char[size]), size });
+		chunk = chunks.size() - 1;
+		offset = 0;
+	}
+}
+
+void JobSystem::start(int workerCount)
+{
+	if (running.load(std::memory_order_acquire))
+		return;
+	std::lock_guard<std::mutex> lock(startMutex);
+	if (running)
+		return;
+
+	if (workerCount <= 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		workerCount = std::max(1, (int)cores - 1);
+	}
+	stopping = false;
+	queues.clear();
+	for (int i = 0; i <= workerCount; ++i)
+		queues.emplace_back(new JobQueue());
+	for (int i = 0; i < workerCount; ++i)
+		workers.emplace_back(workerLoop, i);
+	running = true;
+
+	// workers must be joined before their std::thread objects are destroyed
+	static bool registered = false;
+	if (!registered)
+	{
+		atexit([]() { JobSystem::stop(); });
+		registered = true;
+	}
+}
+
+void JobSystem::stop()
+{
+	std::lock_guard<std::mutex> lock(startMutex);
+	if (!running)
+		return;
+
+	{
+		std::lock_guard<std::mutex> sleepLock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+	running = false;
+}
+
+int JobSystem::concurrency()
+{
+	start();
+	return (int)workers.size() + 1;
+}
+
+void JobSystem::run(Job& job)
+{
+	start();
+	if (job.parent)
+		job.parent->pending.fetch_add(1, std::memory_order_relaxed);
+
+	JobQueue& queue = workerIndex >= 0 ? *queues[workerIndex] : sharedQueue();
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(&job);
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		++queued;
+	}
+	wake.notify_one();
+}
+
+void JobSystem::wait(const Job& job)
+{
+	while (!isDone(job))
+	{
+		Job* child = takeDescendant(job);
+		if (child)
+			execute(child);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::parallelFor(int count, int grain, const std::function<void(int begin, int end)>& body)
+{
+	if (count <= 0)
+		return;
+	grain = std::max(1, grain);
+	int chunks = (count + grain - 1) / grain;
+	if (chunks == 1)
+	{
+		body(0, count);
+		return;
+	}
+
+	Job root;
+	std::vector<Job> children(chunks);
+	for (int c = 0; c < chunks; ++c)
+	{
+		int begin = c * grain;
+		int end = std::min(count, begin + grain);
+		children[c].work = [&body, begin, end]() { body(begin, end); };
+		children[c].parent = &root;
+		run(children[c]);
+	}
+	// the root has no work of its own; finishing it leaves only the children pending
+	finish(&root);
+	wait(root);
+}
+
+ScratchArena& JobSystem::scratch()
+{
+	thread_local ScratchArena arena;
+	return arena;
+}
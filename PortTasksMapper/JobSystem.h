@@ -0,0 +1,90 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Bump allocator for short-lived per-task buffers. Each thread has its own
+// (JobSystem::scratch()), so nothing is shared and nothing is freed until
+// the arena is rewound. Chunks are kept for reuse.
+class ScratchArena
+{
+public:
+	static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+	void* allocate(size_t bytes, size_t alignment = 16);
+	template <typename T>
+	T* allocate(size_t count) { return static_cast<T*>(allocate(count * sizeof(T), alignof(T))); }
+
+	// Rewinds to where the arena was when the scope opened.
+	class Scope
+	{
+	public:
+		explicit Scope(ScratchArena& arena) : arena(arena), chunk(arena.chunk), offset(arena.offset) {}
+		~Scope() { arena.chunk = chunk; arena.offset = offset; }
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		ScratchArena& arena;
+		size_t chunk;
+		size_t offset;
+	};
+
+private:
+	struct Chunk
+	{
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+	std::vector<Chunk> chunks;
+	size_t chunk = 0;
+	size_t offset = 0;
+};
+
+// A unit of work. pending counts the job itself plus its unfinished
+// children, so a job only completes once its whole subtree has; waiting on
+// a parent waits for everything under it. The caller owns the Job and must
+// keep it alive until wait() returns.
+struct Job
+{
+	std::function<void()> work;
+	Job* parent = nullptr;
+	std::atomic<int> pending{ 1 };
+};
+
+// One work-stealing pool shared by every heavy task (decode, meshing,
+// routing, tile rendering), so nested and concurrent parallel work never
+// oversubscribes the cores. Each worker pops its own queue newest first and
+// steals the oldest job from others when it runs dry; threads outside the
+// pool submit to a shared queue. Waiting threads run queued jobs from the
+// subtree they wait on instead of blocking, so waiting inside a job is safe
+// and a waiter never picks up unrelated long-running work.
+class JobSystem
+{
+public:
+	// Starts workers (default: one per core minus the calling thread). Called
+	// lazily by the first run(); stop() joins them and also runs at exit.
+	static void start(int workers = 0);
+	static void stop();
+	// workers plus the submitting thread
+	static int concurrency();
+
+	// Queues job; when job.parent is set the parent also waits for it, which
+	// must be arranged before the parent finishes.
+	static void run(Job& job);
+	static void wait(const Job& job);
+	static bool isDone(const Job& job) { return job.pending.load(std::memory_order_acquire) == 0; }
+
+	// Splits [0, count) into ranges of about grain items, run as children of
+	// one root job, and waits for all of them.
+	static void parallelFor(int count, int grain, const std::function<void(int begin, int end)>& body);
+
+	// the calling thread's arena
+	static ScratchArena& scratch();
+};
+
+#endif // JOBSYSTEM_H
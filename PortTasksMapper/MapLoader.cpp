@@ -1,9 +1,14 @@
 ﻿#include <iostream>
 #include <string.h>
+#include <algorithm>
 #include "MapLoader.h"
+#include "Trace.h"
+#include "MemoryStats.h"
 
 Tile*** MapLoader::loadTerrain(const unsigned char* buf, size_t buf_len)
 {
+	TRACE_SCOPE("loadTerrain", "load");
+	MemoryStats::add(MemoryCategory::Tiles, (long long)terrainBytes());
 	Tile*** tiles = new Tile**[4];
 	for (int z = 0; z < 4; ++z)
 	{
@@ -61,3 +66,182 @@ Tile*** MapLoader::loadTerrain(const unsigned char* buf, size_t buf_len)
 	}
 	return tiles;
 }
+
+void MapLoader::freeTerrain(Tile*** tiles)
+{
+	if (!tiles)
+		return;
+
+	MemoryStats::add(MemoryCategory::Tiles, -(long long)terrainBytes());
+	for (int z = 0; z < 4; ++z)
+	{
+		for (int x = 0; x < 64; ++x)
+		{
+			delete[] tiles[z][x];
+		}
+		delete[] tiles[z];
+	}
+	delete[] tiles;
+}
+
+size_t MapLoader::terrainBytes()
+{
+	return 4 * sizeof(Tile**) + 4 * 64 * sizeof(Tile*) + 4 * 64 * 64 * sizeof(Tile);
+}
+
+void MapLoader::encodeTerrain(Tile*** tiles, std::vector<unsigned char>& out)
+{
+	auto put16 = [&out](int value)
+	{
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)value);
+	};
+
+	for (int z = 0; z < 4; z++)
+	{
+		for (int x = 0; x < 64; x++)
+		{
+			for (int y = 0; y < 64; y++)
+			{
+				const Tile& tile = tiles[z][x][y];
+				if (tile.overlayId != 0)
+				{
+					put16(tile.attrOpcode >= 2 && tile.attrOpcode <= 49 ? tile.attrOpcode : 2 + tile.overlayPath * 4 + (tile.overlayRotation & 3));
+					put16(tile.overlayId);
+				}
+				if (tile.settings != 0)
+					put16(49 + tile.settings);
+				if (tile.underlayId != 0)
+					put16(81 + tile.underlayId);
+
+				if (tile.height != 0)
+				{
+					put16(1);
+					out.push_back((unsigned char)tile.height);
+				}
+				else
+				{
+					put16(0);
+				}
+			}
+		}
+	}
+}
+
+namespace
+{
+	// 1 byte below 128, otherwise 2 bytes offset by 32768
+	bool readShortSmart(const unsigned char* buf, size_t buf_len, size_t& offset, int& value)
+	{
+		if (offset >= buf_len)
+			return false;
+		if (buf[offset] < 128)
+		{
+			value = buf[offset++];
+			return true;
+		}
+		if (offset + 1 >= buf_len)
+			return false;
+		value = (buf[offset] << 8 | buf[offset + 1]) - 32768;
+		offset += 2;
+		return true;
+	}
+
+	void writeShortSmart(std::vector<unsigned char>& out, int value)
+	{
+		if (value < 128)
+		{
+			out.push_back((unsigned char)value);
+		}
+		else
+		{
+			value += 32768;
+			out.push_back((unsigned char)(value >> 8));
+			out.push_back((unsigned char)value);
+		}
+	}
+
+	const int LOC_TYPE_COUNT = 23;
+}
+
+bool MapLoader::loadLocations(const unsigned char* buf, size_t buf_len, RegionObjects& out)
+{
+	TRACE_SCOPE("loadLocations", "load");
+	out.clear();
+
+	size_t offset = 0;
+	long long id = -1;
+	for (;;)
+	{
+		// id deltas above 32766 are split into runs of 32767
+		int idOffset = 0;
+		int part;
+		do
+		{
+			if (!readShortSmart(buf, buf_len, offset, part))
+				return false;
+			idOffset += part;
+		} while (part == 32767);
+		if (idOffset == 0)
+			break;
+		id += idOffset;
+
+		int position = 0;
+		for (;;)
+		{
+			int positionOffset;
+			if (!readShortSmart(buf, buf_len, offset, positionOffset))
+				return false;
+			if (positionOffset == 0)
+				break;
+			position += positionOffset - 1;
+			if (position > 0x3FFF || offset >= buf_len)
+				return false;
+
+			unsigned char shape = buf[offset++];
+			if ((shape >> 2) >= LOC_TYPE_COUNT)
+				return false;
+			out.ids.push_back((uint32_t)id);
+			out.positions.push_back((uint16_t)position);
+			out.shapes.push_back(shape);
+		}
+	}
+	return true;
+}
+
+void MapLoader::encodeLocations(const RegionObjects& objects, std::vector<unsigned char>& out)
+{
+	std::vector<size_t> order(objects.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&objects](size_t a, size_t b)
+	{
+		if (objects.ids[a] != objects.ids[b])
+			return objects.ids[a] < objects.ids[b];
+		return objects.positions[a] < objects.positions[b];
+	});
+
+	long long id = -1;
+	int position = 0;
+	for (size_t n = 0; n < order.size(); ++n)
+	{
+		size_t i = order[n];
+		if (objects.ids[i] != id)
+		{
+			if (id != -1)
+				writeShortSmart(out, 0);
+			long long idOffset = objects.ids[i] - id;
+			for (; idOffset >= 32767; idOffset -= 32767)
+				writeShortSmart(out, 32767);
+			writeShortSmart(out, (int)idOffset);
+			id = objects.ids[i];
+			position = 0;
+		}
+		writeShortSmart(out, objects.positions[i] - position + 1);
+		position = objects.positions[i];
+		out.push_back(objects.shapes[i]);
+	}
+	if (id != -1)
+		writeShortSmart(out, 0);
+	writeShortSmart(out, 0);
+}
@@ -2,12 +2,26 @@
 #define MAPLOADER_H
 
 #include <cstddef>
+#include <vector>
 #include "Tile.h"
+#include "RegionObjects.h"
 
 class MapLoader
 {
 public:
 	static Tile*** loadTerrain(const unsigned char* buf, size_t buf_len);
+	static void freeTerrain(Tile*** tiles);
+	// heap bytes behind one decoded region (four planes and their row pointers)
+	static size_t terrainBytes();
+	// Inverse of loadTerrain: writes the attribute stream for all four planes.
+	static void encodeTerrain(Tile*** tiles, std::vector<unsigned char>& out);
+
+	// Decodes a (decrypted) l file into out. Returns false when the stream is
+	// truncated or holds impossible positions or types, which is what a wrong
+	// XTEA key looks like.
+	static bool loadLocations(const unsigned char* buf, size_t buf_len, RegionObjects& out);
+	// Inverse of loadLocations; objects are written sorted by id and position.
+	static void encodeLocations(const RegionObjects& objects, std::vector<unsigned char>& out);
 };
 
 #endif
\ No newline at end of file
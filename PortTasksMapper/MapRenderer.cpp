@@ -10,20 +10,34 @@
 #include "Tile.h"
 #include "Underlay.h"
 #include "MapRenderer.h"
+#include "TerrainMesh.h"
+#include "FrameProfiler.h"
+#include "Trace.h"
+#include "MemoryStats.h"
+#include "Path.h"
+#include "EditHistory.h"
+#include "WorldMap.h"
+#include "JobSystem.h"
+#include "imgui.h"
 
-struct Vertex {
+static GLuint shaderProgram = 0;
+static GLuint impostorProgram = 0;
+static GLuint impostorVAO = 0, impostorVBO = 0;
+static GLuint objectProgram = 0;
+static GLuint objectBoxVBO = 0;
+
+// per-instance data for object markers
+struct ObjectInstance {
 	float x, y, z;
-	float r, g, b;
+	unsigned int shape;
 };
 
-static GLuint vao = 0, vbo = 0;
-static GLuint shaderProgram = 0;
+// 64x64 RGB8 plus every mip level down to 1x1
+static const size_t IMPOSTOR_TEXTURE_BYTES = 3 * (4096 + 1024 + 256 + 64 + 16 + 4 + 1);
 
 const int MAP_WIDTH = 64;
 const int MAP_HEIGHT = 64;
 
-extern GLuint shaderProgram;
-extern GLuint vao;
 
 float yaw = -90.0f;
 float pitch = -70.0f;
@@ -47,21 +61,91 @@ void setDistance(float d) { distance = std::clamp(d, 100.0f, 300.0f); }
 
 float cornerHeights[65][65] = {};
 
+extern EditHistory editHistory;
+
+float MapRenderer::terrainHeight(float tileX, float tileY) {
+	// bilinear over the smoothed corner heights the mesh is built from
+	float fx = std::clamp(tileX, 0.0f, 64.0f);
+	float fy = std::clamp(tileY, 0.0f, 64.0f);
+	int x0 = std::min((int)fx, 63);
+	int y0 = std::min((int)fy, 63);
+	float tx = fx - x0;
+	float ty = fy - y0;
+	float h0 = cornerHeights[x0][y0] * (1 - tx) + cornerHeights[x0 + 1][y0] * tx;
+	float h1 = cornerHeights[x0][y0 + 1] * (1 - tx) + cornerHeights[x0 + 1][y0 + 1] * tx;
+	return h0 * (1 - ty) + h1 * ty;
+}
+
+bool MapRenderer::hasSelection() {
+	const std::vector<Path>& paths = savedPaths.paths();
+	return selectedPath >= 0 && selectedPath < (int)paths.size()
+		&& selectedPoint >= 0 && selectedPoint < (int)paths[selectedPath].points.size();
+}
+
+void MapRenderer::clearSelection() {
+	selectedPath = -1;
+	selectedPoint = -1;
+	dragging = false;
+}
+
+void MapRenderer::requestRedraw() {
+	pendingFrames = 3;
+	glfwPostEmptyEvent();
+}
+
+bool MapRenderer::takeRedraw() {
+	int pending = pendingFrames.load();
+	while (pending > 0 && !pendingFrames.compare_exchange_weak(pending, pending - 1))
+		;
+	return pending > 0;
+}
+
+bool MapRenderer::isInteracting() {
+	return rotating || panning || dragging;
+}
+
+void MapRenderer::initMap() {
+	createShader();
+	createImpostorQuad();
+	createObjectBox();
+	pathRenderer.init();
+}
+
 void MapRenderer::resetCamera() {
 	setYaw(90.f);
 	setPitch(45.0f);
 	setDistance(180.0f);
 }
 
+static GLuint linkProgram(const char* vertSrc, const char* fragSrc) {
+	GLuint vert = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vert, 1, &vertSrc, nullptr);
+	glCompileShader(vert);
+
+	GLuint frag = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(frag, 1, &fragSrc, nullptr);
+	glCompileShader(frag);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vert);
+	glAttachShader(program, frag);
+	glLinkProgram(program);
+
+	glDeleteShader(vert);
+	glDeleteShader(frag);
+	return program;
+}
+
 void MapRenderer::createShader() {
 	const char* vertSrc = R"(
         #version 330 core
         layout (location = 0) in vec3 aPos;
         layout (location = 1) in vec3 aColor;
         uniform mat4 uVP;
+        uniform vec3 uOffset;
         out vec3 vColor;
         void main() {
-            gl_Position = uVP * vec4(aPos, 1.0);
+            gl_Position = uVP * vec4(aPos + uOffset, 1.0);
             vColor = aColor;
         }
     )";
@@ -75,97 +159,443 @@ void MapRenderer::createShader() {
         }
     )";
 
-	GLuint vert = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vert, 1, &vertSrc, nullptr);
-	glCompileShader(vert);
+	shaderProgram = linkProgram(vertSrc, fragSrc);
 
-	GLuint frag = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(frag, 1, &fragSrc, nullptr);
-	glCompileShader(frag);
+	const char* impostorVertSrc = R"(
+        #version 330 core
+        layout (location = 0) in vec3 aPos;
+        layout (location = 1) in vec2 aUV;
+        uniform mat4 uVP;
+        uniform vec3 uOffset;
+        out vec2 vUV;
+        void main() {
+            gl_Position = uVP * vec4(aPos + uOffset, 1.0);
+            vUV = aUV;
+        }
+    )";
+
+	const char* impostorFragSrc = R"(
+        #version 330 core
+        in vec2 vUV;
+        uniform sampler2D uColors;
+        out vec4 FragColor;
+        void main() {
+            FragColor = vec4(texture(uColors, vUV).rgb, 1.0);
+        }
+    )";
 
-	shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vert);
-	glAttachShader(shaderProgram, frag);
-	glLinkProgram(shaderProgram);
+	impostorProgram = linkProgram(impostorVertSrc, impostorFragSrc);
 
-	glDeleteShader(vert);
-	glDeleteShader(frag);
+	// box size, placement and colour follow the loc type: walls (0-3, 9) are
+	// slabs on the tile edge given by the orientation, wall decoration (4-8)
+	// small boxes on that edge, roofs (12-21) flat slabs overhead, ground
+	// decoration (22) flat tiles and everything else a box in the middle
+	const char* objectVertSrc = R"(
+        #version 330 core
+        layout (location = 0) in vec3 aPos;
+        layout (location = 2) in vec3 iPos;
+        layout (location = 3) in uint iShape;
+        uniform mat4 uVP;
+        uniform vec3 uOffset;
+        out vec3 vColor;
+        void main() {
+            uint type = iShape >> 2u;
+            int orientation = int(iShape & 3u);
+            vec3 size = vec3(2.4, 3.0, 2.4);
+            vec2 shift = vec2(0.0);
+            vec3 color = vec3(0.85, 0.55, 0.2);
+            if (type <= 3u || type == 9u) {
+                size = vec3(0.5, 5.0, 4.0); shift = vec2(-1.75, 0.0); color = vec3(0.75, 0.2, 0.2);
+            } else if (type <= 8u) {
+                size = vec3(0.6, 1.2, 1.2); shift = vec2(-1.6, 0.0); color = vec3(0.9, 0.8, 0.3);
+            } else if (type >= 12u && type <= 21u) {
+                size = vec3(4.0, 0.4, 4.0); shift = vec2(0.0); color = vec3(0.3, 0.4, 0.8);
+            } else if (type == 22u) {
+                size = vec3(2.0, 0.3, 2.0); color = vec3(0.5, 0.7, 0.4);
+            }
+            vec3 local = aPos * size;
+            local.xz += shift;
+            if (type >= 12u && type <= 21u)
+                local.y += 6.0;
+            // each orientation step turns a quarter clockwise seen from above
+            for (int i = 0; i < orientation; ++i)
+                local.xz = vec2(-local.z, local.x);
+            gl_Position = uVP * vec4(iPos + local + uOffset, 1.0);
+            vColor = color * (0.6 + 0.4 * aPos.y);
+        }
+    )";
+
+	const char* objectFragSrc = R"(
+        #version 330 core
+        in vec3 vColor;
+        out vec4 FragColor;
+        void main() {
+            FragColor = vec4(vColor, 1.0);
+        }
+    )";
+
+	objectProgram = linkProgram(objectVertSrc, objectFragSrc);
 }
 
-void MapRenderer::uploadTileMesh(Tile*** tiles) {
-	std::vector<Vertex> verts;
-	float tileSize = 4.0f;
-	float heightScale = 0.300f;
-
-	for (int y = 0; y <= 64; ++y) {
-		for (int x = 0; x <= 64; ++x) {
-			float sum = 0.f;
-			int count = 0;
-			for (int dy = -1; dy <= 1; ++dy) {
-				for (int dx = -1; dx <= 1; ++dx) {
-					int tx = x + dx;
-					int ty = y + dy;
-					if (tx >= 0 && tx < 64 && ty >= 0 && ty < 64) {
-						sum += tiles[0][tx][ty].height;
-						count++;
-					}
-				}
-			}
-			cornerHeights[x][y] = (count > 0 ? sum / count : 0.f) * heightScale;
-		}
+void MapRenderer::createObjectBox() {
+	// unit box centred on the tile in x/z, standing on y = 0
+	const float corners[8][3] = {
+		{ -0.5f, 0.0f, -0.5f }, { 0.5f, 0.0f, -0.5f }, { 0.5f, 1.0f, -0.5f }, { -0.5f, 1.0f, -0.5f },
+		{ -0.5f, 0.0f,  0.5f }, { 0.5f, 0.0f,  0.5f }, { 0.5f, 1.0f,  0.5f }, { -0.5f, 1.0f,  0.5f },
+	};
+	const int faces[36] = {
+		0, 1, 2, 0, 2, 3,  4, 6, 5, 4, 7, 6,
+		0, 3, 7, 0, 7, 4,  1, 5, 6, 1, 6, 2,
+		3, 2, 6, 3, 6, 7,  0, 4, 5, 0, 5, 1,
+	};
+	float box[36 * 3];
+	for (int i = 0; i < 36; ++i)
+		for (int c = 0; c < 3; ++c)
+			box[i * 3 + c] = corners[faces[i]][c];
+
+	glGenBuffers(1, &objectBoxVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, objectBoxVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(box), box, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MapRenderer::installRegionObjects(int regionX, int regionY, const RegionObjects& objects,
+	const float heights[TerrainMesh::SIZE + 1][TerrainMesh::SIZE + 1]) {
+	TRACE_SCOPE("uploadObjects", "gpu");
+	int id = WorldMap::regionId(regionX, regionY);
+	auto existing = regionObjects.find(id);
+	if (existing != regionObjects.end()) {
+		MemoryStats::add(MemoryCategory::GpuBuffers, -(long long)(existing->second.count * sizeof(ObjectInstance)));
+		glDeleteBuffers(1, &existing->second.vbo);
+		glDeleteVertexArrays(1, &existing->second.vao);
+		regionObjects.erase(existing);
 	}
+	if (objects.size() == 0)
+		return;
 
-	for (int y = 0; y < 64; ++y) {
-		for (int x = 0; x < 64; ++x) {
-			Tile& tile = tiles[0][x][y];
-			glm::vec3 color;
-			if (tile.overlayId != 0)
-				color = getOverlayRGB(tile.overlayId);
-			else
-				color = getUnderlayRGB(tile.underlayId);
-			float r = color.r, g = color.g, b = color.b;
-
-			float h00 = cornerHeights[x][y];
-			float h10 = cornerHeights[x + 1][y];
-			float h11 = cornerHeights[x + 1][y + 1];
-			float h01 = cornerHeights[x][y + 1];
-
-			float left = x * tileSize;
-			float right = (x + 1) * tileSize;
-			float top = (MAP_HEIGHT - 1 - y) * tileSize;
-			float bottom = (MAP_HEIGHT - 1 - (y + 1)) * tileSize;
-
-			verts.push_back({ left,  h00, top,    r, g, b });
-			verts.push_back({ right, h10, top,    r, g, b });
-			verts.push_back({ right, h11, bottom, r, g, b });
-
-			verts.push_back({ left,  h00, top,    r, g, b });
-			verts.push_back({ right, h11, bottom, r, g, b });
-			verts.push_back({ left,  h01, bottom, r, g, b });
-		}
+	// upper planes have no smoothed heights of their own; lift them a storey each
+	const float storey = 8.0f;
+	std::vector<ObjectInstance> instances(objects.size());
+	for (size_t i = 0; i < objects.size(); ++i) {
+		int x = RegionObjects::localX(objects.positions[i]);
+		int y = RegionObjects::localY(objects.positions[i]);
+		ObjectInstance& instance = instances[i];
+		instance.x = (x + 0.5f) * TerrainMesh::TILE_SIZE;
+		instance.z = (TerrainMesh::SIZE - 1.5f - y) * TerrainMesh::TILE_SIZE;
+		instance.y = (heights[x][y] + heights[x + 1][y] + heights[x][y + 1] + heights[x + 1][y + 1]) * 0.25f
+			+ RegionObjects::plane(objects.positions[i]) * storey;
+		instance.shape = objects.shapes[i];
+	}
+
+	ObjectBatch batch;
+	batch.count = (int)instances.size();
+	glGenVertexArrays(1, &batch.vao);
+	glGenBuffers(1, &batch.vbo);
+	glBindVertexArray(batch.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, objectBoxVBO);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(ObjectInstance), instances.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ObjectInstance), (void*)0);
+	glEnableVertexAttribArray(2);
+	glVertexAttribDivisor(2, 1);
+	glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(ObjectInstance), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(3);
+	glVertexAttribDivisor(3, 1);
+	glBindVertexArray(0);
+	FrameProfiler::countUpload(instances.size() * sizeof(ObjectInstance));
+	MemoryStats::add(MemoryCategory::GpuBuffers, (long long)(instances.size() * sizeof(ObjectInstance)));
+
+	regionObjects[id] = batch;
+	requestRedraw();
+}
+
+void MapRenderer::createImpostorQuad() {
+	// covers the same ground as the region mesh: tile y spans
+	// z = (SIZE - 1 - y) * TILE_SIZE down one tile, so texel row y maps there too
+	const float span = TerrainMesh::SIZE * TerrainMesh::TILE_SIZE;
+	const float north = (TerrainMesh::SIZE - 1) * TerrainMesh::TILE_SIZE;
+	const float south = north - span;
+	const float quad[] = {
+		0.0f, 0.0f, north, 0.0f, 0.0f,
+		span, 0.0f, north, 1.0f, 0.0f,
+		span, 0.0f, south, 1.0f, 1.0f,
+		0.0f, 0.0f, north, 0.0f, 0.0f,
+		span, 0.0f, south, 1.0f, 1.0f,
+		0.0f, 0.0f, south, 0.0f, 1.0f,
+	};
+
+	glGenVertexArrays(1, &impostorVAO);
+	glGenBuffers(1, &impostorVBO);
+	glBindVertexArray(impostorVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, impostorVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	glBindVertexArray(0);
+}
+
+void MapRenderer::installRegionImpostor(int regionX, int regionY, const unsigned char* rgb,
+	const float heights[TerrainMesh::SIZE + 1][TerrainMesh::SIZE + 1]) {
+	TRACE_SCOPE("bakeImpostor", "gpu");
+	RegionImpostor& impostor = regionImpostors[WorldMap::regionId(regionX, regionY)];
+
+	float sum = 0.0f;
+	for (int x = 0; x <= TerrainMesh::SIZE; ++x)
+		for (int y = 0; y <= TerrainMesh::SIZE; ++y)
+			sum += heights[x][y];
+	impostor.height = sum / ((TerrainMesh::SIZE + 1) * (TerrainMesh::SIZE + 1));
+
+	if (!impostor.texture) {
+		glGenTextures(1, &impostor.texture);
+		glBindTexture(GL_TEXTURE_2D, impostor.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	}
+	else {
+		glBindTexture(GL_TEXTURE_2D, impostor.texture);
+	}
+	// rows are 192 bytes, so the default unpack alignment of 4 holds
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, TerrainMesh::SIZE, TerrainMesh::SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	FrameProfiler::countUpload(TerrainMesh::SIZE * TerrainMesh::SIZE * 3);
+	requestRedraw();
+}
 
-	vertexCount = verts.size();
-	if (vao) glDeleteVertexArrays(1, &vao);
-	if (vbo) glDeleteBuffers(1, &vbo);
+size_t MapRenderer::impostorBytes() {
+	return regionImpostors.size() * IMPOSTOR_TEXTURE_BYTES;
+}
 
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
+void MapRenderer::uploadTileMesh(int regionX, int regionY, Tile*** tiles) {
+	if (!tiles)
+		return;
 
-	createShader();
+	TRACE_SCOPE("uploadTileMesh", "mesh");
+	BuiltMesh built;
+	buildTileMesh(regionX, regionY, tiles, built);
+	installTileMesh(built);
+}
 
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+void MapRenderer::uploadTileMeshes(const std::unordered_map<int, Tile***>& regions) {
+	TRACE_SCOPE("uploadTileMeshes", "mesh");
+	std::vector<std::pair<int, Tile***>> sources(regions.begin(), regions.end());
+	std::vector<BuiltMesh> built(sources.size());
+	JobSystem::parallelFor((int)sources.size(), 1, [&](int begin, int end) {
+		for (int i = begin; i < end; ++i)
+			if (sources[i].second)
+				buildTileMesh(WorldMap::regionX(sources[i].first), WorldMap::regionY(sources[i].first), sources[i].second, built[i]);
+	});
+	for (size_t i = 0; i < sources.size(); ++i)
+		if (sources[i].second)
+			installTileMesh(built[i]);
+}
+
+void MapRenderer::buildTileMesh(int regionX, int regionY, Tile*** tiles, BuiltMesh& out) {
+	TRACE_SCOPE("buildMesh", "mesh");
+	out.regionX = regionX;
+	out.regionY = regionY;
+	auto overlay = [regionX, regionY](int x, int y, glm::vec3& color) {
+		return tileOverlay && tileOverlay(regionX * 64 + x, regionY * 64 + y, color);
+	};
+	TerrainMesh::smoothHeights(tiles, out.heights);
+	TerrainMesh::buildVertices(tiles, out.heights, overlay, out.verts);
+	TerrainMesh::bakeColors(tiles, overlay, out.colors);
+}
+
+void MapRenderer::installTileMesh(BuiltMesh& built) {
+	int regionX = built.regionX;
+	int regionY = built.regionY;
+	std::vector<Vertex>& verts = built.verts;
+	if (regionX == HOME_REGION_X && regionY == HOME_REGION_Y)
+		std::copy(&built.heights[0][0], &built.heights[0][0] + 65 * 65, &cornerHeights[0][0]);
+	installRegionImpostor(regionX, regionY, built.colors, built.heights);
+
+	// edits should show up this frame, so this skips the per-frame budget and
+	// supersedes any older mesh of the region still being uploaded, here or
+	// on the upload thread
+	++regionGenerations[WorldMap::regionId(regionX, regionY)];
+	for (auto it = pendingUploads.begin(); it != pendingUploads.end();) {
+		if (it->regionX == regionX && it->regionY == regionY) {
+			MemoryStats::add(MemoryCategory::MeshStaging, -(long long)(it->verts.capacity() * sizeof(Vertex)));
+			deleteMesh(it->mesh, it->verts.size() * sizeof(Vertex));
+			it = pendingUploads.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	TRACE_SCOPE("gpuUpload", "gpu");
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
 	glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(Vertex), verts.data(), GL_STATIC_DRAW);
+	FrameProfiler::countUpload(verts.size() * sizeof(Vertex));
+	MemoryStats::add(MemoryCategory::GpuBuffers, (long long)(verts.size() * sizeof(Vertex)));
+	installRegionMesh(regionX, regionY, buffer, (int)verts.size());
+}
 
+void MapRenderer::installRegionMesh(int regionX, int regionY, unsigned int buffer, int vertices) {
+	RegionMesh mesh;
+	mesh.vbo = buffer;
+	mesh.vertexCount = vertices;
+	glGenVertexArrays(1, &mesh.vao);
+	glBindVertexArray(mesh.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
 	glEnableVertexAttribArray(0);
-
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(1);
+	glBindVertexArray(0);
+	replaceRegionMesh(regionX, regionY, mesh);
+}
+
+void MapRenderer::replaceRegionMesh(int regionX, int regionY, const RegionMesh& mesh) {
+	int id = WorldMap::regionId(regionX, regionY);
+	auto existing = regionMeshes.find(id);
+	if (existing != regionMeshes.end())
+		deleteMesh(existing->second, existing->second.vertexCount * sizeof(Vertex));
+	regionMeshes[id] = mesh;
+
+	vertexCount = 0;
+	for (const auto& entry : regionMeshes)
+		vertexCount += entry.second.vertexCount;
+	++meshRevision;
+	requestRedraw();
+}
+
+void MapRenderer::queueRegionMesh(int regionX, int regionY, std::vector<Vertex>&& verts) {
+	PendingUpload upload;
+	upload.regionX = regionX;
+	upload.regionY = regionY;
+	upload.verts = std::move(verts);
+
+	// storage now, contents in budgeted slices from uploadPending
+	size_t bytes = upload.verts.size() * sizeof(Vertex);
+	glGenBuffers(1, &upload.mesh.vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, upload.mesh.vbo);
+	glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+	MemoryStats::add(MemoryCategory::GpuBuffers, (long long)bytes);
+
+	pendingUploads.push_back(std::move(upload));
+}
+
+size_t MapRenderer::uploadPending(size_t byteBudget) {
+	size_t spent = 0;
+	while (!pendingUploads.empty()) {
+		PendingUpload& upload = pendingUploads.front();
+		size_t total = upload.verts.size() * sizeof(Vertex);
+		if (spent >= byteBudget)
+			break;
+		size_t slice = std::min(total - upload.uploaded, byteBudget - spent);
+
+		if (slice > 0) {
+			TRACE_SCOPE("gpuUpload", "gpu");
+			glBindBuffer(GL_ARRAY_BUFFER, upload.mesh.vbo);
+			glBufferSubData(GL_ARRAY_BUFFER, upload.uploaded, slice, (const char*)upload.verts.data() + upload.uploaded);
+			FrameProfiler::countUpload(slice);
+			upload.uploaded += slice;
+			spent += slice;
+		}
+		if (upload.uploaded < total)
+			break;
+
+		// complete: replaces whatever was drawn for the region so far
+		MemoryStats::add(MemoryCategory::MeshStaging, -(long long)(upload.verts.capacity() * sizeof(Vertex)));
+		installRegionMesh(upload.regionX, upload.regionY, upload.mesh.vbo, (int)upload.verts.size());
+		pendingUploads.pop_front();
+	}
+	return spent;
+}
+
+bool MapRenderer::hasPendingUploads() {
+	return !pendingUploads.empty();
+}
+
+void MapRenderer::setHomeHeights(const float heights[TerrainMesh::SIZE + 1][TerrainMesh::SIZE + 1]) {
+	std::copy(&heights[0][0], &heights[0][0] + 65 * 65, &cornerHeights[0][0]);
+	++meshRevision;
+}
+
+unsigned int MapRenderer::regionGeneration(int regionX, int regionY) {
+	auto it = regionGenerations.find(WorldMap::regionId(regionX, regionY));
+	return it == regionGenerations.end() ? 0 : it->second;
+}
+
+void MapRenderer::removeRegion(int regionX, int regionY) {
+	int id = WorldMap::regionId(regionX, regionY);
+	// kept rather than erased, so a reloaded region never matches a stale upload
+	++regionGenerations[id];
+	for (auto it = pendingUploads.begin(); it != pendingUploads.end();) {
+		if (it->regionX == regionX && it->regionY == regionY) {
+			MemoryStats::add(MemoryCategory::MeshStaging, -(long long)(it->verts.capacity() * sizeof(Vertex)));
+			deleteMesh(it->mesh, it->verts.size() * sizeof(Vertex));
+			it = pendingUploads.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	auto mesh = regionMeshes.find(id);
+	if (mesh != regionMeshes.end()) {
+		deleteMesh(mesh->second, mesh->second.vertexCount * sizeof(Vertex));
+		regionMeshes.erase(mesh);
+		vertexCount = 0;
+		for (const auto& entry : regionMeshes)
+			vertexCount += entry.second.vertexCount;
+		++meshRevision;
+	}
+
+	auto impostor = regionImpostors.find(id);
+	if (impostor != regionImpostors.end()) {
+		glDeleteTextures(1, &impostor->second.texture);
+		regionImpostors.erase(impostor);
+	}
+
+	auto objects = regionObjects.find(id);
+	if (objects != regionObjects.end()) {
+		MemoryStats::add(MemoryCategory::GpuBuffers, -(long long)(objects->second.count * sizeof(ObjectInstance)));
+		glDeleteBuffers(1, &objects->second.vbo);
+		glDeleteVertexArrays(1, &objects->second.vao);
+		regionObjects.erase(objects);
+	}
+	requestRedraw();
+}
+
+size_t MapRenderer::regionGpuBytes(int regionX, int regionY) {
+	int id = WorldMap::regionId(regionX, regionY);
+	size_t bytes = 0;
+	auto mesh = regionMeshes.find(id);
+	if (mesh != regionMeshes.end())
+		bytes += mesh->second.vertexCount * sizeof(Vertex);
+	for (const PendingUpload& upload : pendingUploads)
+		if (upload.regionX == regionX && upload.regionY == regionY)
+			bytes += upload.verts.size() * sizeof(Vertex);
+	if (regionImpostors.count(id))
+		bytes += IMPOSTOR_TEXTURE_BYTES;
+	auto objects = regionObjects.find(id);
+	if (objects != regionObjects.end())
+		bytes += objects->second.count * sizeof(ObjectInstance);
+	return bytes;
+}
+
+void MapRenderer::deleteMesh(RegionMesh& mesh, size_t bytes) {
+	MemoryStats::add(MemoryCategory::GpuBuffers, -(long long)bytes);
+	glDeleteBuffers(1, &mesh.vbo);
+	glDeleteVertexArrays(1, &mesh.vao);
+	mesh = RegionMesh();
 }
 
 void MapRenderer::renderMap() {
+	TRACE_SCOPE("renderMap", "render");
+	FrameProfiler::beginStage(FrameStage::Terrain);
 	glUseProgram(shaderProgram);
 
 	int width, height;
@@ -192,18 +622,81 @@ void MapRenderer::renderMap() {
 	GLuint loc = glGetUniformLocation(shaderProgram, "uVP");
 	glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(vp));
 
-	glBindVertexArray(vao);
-	glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+	// each region mesh is built in local coordinates and shifted into place;
+	// distant regions, and ones whose mesh is still uploading, get their impostor
+	GLint offsetLoc = glGetUniformLocation(shaderProgram, "uOffset");
+	const float regionSpan = TerrainMesh::SIZE * TerrainMesh::TILE_SIZE;
+	auto regionOffset = [regionSpan](int id) {
+		return glm::vec3((WorldMap::regionX(id) - HOME_REGION_X) * regionSpan, 0.0f, (HOME_REGION_Y - WorldMap::regionY(id)) * regionSpan);
+	};
+	auto useImpostor = [&](int id) {
+		auto impostor = regionImpostors.find(id);
+		if (impostor == regionImpostors.end())
+			return false;
+		if (regionMeshes.find(id) == regionMeshes.end())
+			return true;
+		// distance to the nearest point of the region's ground rectangle
+		glm::vec3 offset = regionOffset(id);
+		float north = offset.z + (TerrainMesh::SIZE - 1) * TerrainMesh::TILE_SIZE;
+		glm::vec3 nearest(
+			std::clamp(cameraPos.x, offset.x, offset.x + regionSpan),
+			impostor->second.height,
+			std::clamp(cameraPos.z, north - regionSpan, north));
+		return glm::distance(cameraPos, nearest) > IMPOSTOR_DISTANCE;
+	};
+
+	for (const auto& entry : regionMeshes) {
+		if (useImpostor(entry.first))
+			continue;
+		glm::vec3 offset = regionOffset(entry.first);
+		glUniform3f(offsetLoc, offset.x, offset.y, offset.z);
+		glBindVertexArray(entry.second.vao);
+		glDrawArrays(GL_TRIANGLES, 0, entry.second.vertexCount);
+		FrameProfiler::countDraw(entry.second.vertexCount);
+	}
+	glUniform3f(offsetLoc, 0.0f, 0.0f, 0.0f);
+
+	glUseProgram(impostorProgram);
+	glUniformMatrix4fv(glGetUniformLocation(impostorProgram, "uVP"), 1, GL_FALSE, glm::value_ptr(vp));
+	glUniform1i(glGetUniformLocation(impostorProgram, "uColors"), 0);
+	GLint impostorOffsetLoc = glGetUniformLocation(impostorProgram, "uOffset");
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(impostorVAO);
+	for (const auto& entry : regionImpostors) {
+		if (!useImpostor(entry.first))
+			continue;
+		glm::vec3 offset = regionOffset(entry.first);
+		glUniform3f(impostorOffsetLoc, offset.x, entry.second.height, offset.z);
+		glBindTexture(GL_TEXTURE_2D, entry.second.texture);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		FrameProfiler::countDraw(6);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (showObjects) {
+		glUseProgram(objectProgram);
+		glUniformMatrix4fv(glGetUniformLocation(objectProgram, "uVP"), 1, GL_FALSE, glm::value_ptr(vp));
+		GLint objectOffsetLoc = glGetUniformLocation(objectProgram, "uOffset");
+		for (const auto& entry : regionObjects) {
+			if (regionMeshes.find(entry.first) == regionMeshes.end() || useImpostor(entry.first))
+				continue;
+			glm::vec3 offset = regionOffset(entry.first);
+			glUniform3f(objectOffsetLoc, offset.x, offset.y, offset.z);
+			glBindVertexArray(entry.second.vao);
+			glDrawArraysInstanced(GL_TRIANGLES, 0, 36, entry.second.count);
+			FrameProfiler::countDraw(36 * entry.second.count);
+		}
+	}
+	glBindVertexArray(0);
+	glUseProgram(shaderProgram);
+	FrameProfiler::endStage(FrameStage::Terrain);
 
+	FrameProfiler::beginStage(FrameStage::Picking);
 	glm::vec3 ray = getRayFromMouse(window, view, projection);
 	glm::vec3 hit = intersectRayWithGround(cameraPos, ray);
 
-	const float tileSize = 4.0f;
-	int tileX = static_cast<int>(std::floor(hit.x / tileSize));
-	int tileY = static_cast<int>(std::floor(hit.z / tileSize));
-	tileX = std::clamp(tileX, 0, 63);
-	tileY = std::clamp(tileY, 0, 63);
-	tileY = (MAP_HEIGHT - 1) - tileY;
+	int tileX, tileY;
+	TerrainMesh::hitToTile(hit, tileX, tileY);
 
 
 	int hoverTileX = tileX;
@@ -213,6 +706,15 @@ void MapRenderer::renderMap() {
 	guiHoverTileY = hoverTileY;
 	guitiles = tiles;
 
+	if (dragging && hasSelection()) {
+		WorldPoint dragged = { 50 * 64 + hoverTileX, 50 * 64 + hoverTileY, dragFrom.plane };
+		if (savedPaths.paths()[selectedPath].points[selectedPoint] != dragged)
+			savedPaths.setPoint(selectedPath, selectedPoint, dragged);
+	}
+	FrameProfiler::endStage(FrameStage::Picking);
+
+	FrameProfiler::Scope overlayScope(FrameStage::Overlay);
+
 	if (hoverTileX >= 0 && hoverTileX < 64 && hoverTileY >= 0 && hoverTileY < 64) {
 		float tileSize = 4.0f;
 		// Use same smoothing as mesh!
@@ -244,20 +746,24 @@ void MapRenderer::renderMap() {
 		glBindVertexArray(tempVAO);
 		glBindBuffer(GL_ARRAY_BUFFER, tempVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(highlightVerts), highlightVerts, GL_STATIC_DRAW);
+		FrameProfiler::countUpload(sizeof(highlightVerts));
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
 		glEnableVertexAttribArray(1);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
+		FrameProfiler::countDraw(6);
 		glDeleteBuffers(1, &tempVBO);
 		glDeleteVertexArrays(1, &tempVAO);
 	}
+
+	pathRenderer.render(savedPaths, vp, hasSelection() ? selectedPath : -1, selectedPoint);
+
 	std::cout << "Tile: " << tileX << ", " << tileY << "\n";
 }
 
 glm::vec3 MapRenderer::intersectRayWithGround(glm::vec3 rayOrigin, glm::vec3 rayDir) {
-	float t = -rayOrigin.y / rayDir.y;
-	return rayOrigin + rayDir * t;
+	return TerrainMesh::intersectGround(rayOrigin, rayDir);
 }
 
 glm::vec3 MapRenderer::getRayFromMouse(GLFWwindow* window, const glm::mat4& view, const glm::mat4& projection) {
@@ -267,23 +773,42 @@ glm::vec3 MapRenderer::getRayFromMouse(GLFWwindow* window, const glm::mat4& view
 	glfwGetCursorPos(window, &mouseX, &mouseY);
 	float x = (2.0f * (float)mouseX) / winWidth - 1.0f;
 	float y = 1.0f - (2.0f * (float)mouseY) / winHeight;
-	float z = 1.0f;
-	glm::vec3 ray_nds = glm::vec3(x, y, z);
-	glm::vec4 ray_clip = glm::vec4(ray_nds, 1.0);
-	glm::vec4 ray_eye = glm::inverse(projection) * ray_clip;
-	ray_eye = glm::vec4(ray_eye.x, ray_eye.y, -1.0, 0.0);
-	glm::vec3 ray_world = glm::vec3(glm::inverse(view) * ray_eye);
-	return glm::normalize(ray_world);
+	return TerrainMesh::rayFromScreen(x, y, view, projection);
 }
 
 void MapRenderer::cleanupMap() {
+	pathRenderer.cleanup();
 	glDeleteProgram(shaderProgram);
-	glDeleteBuffers(1, &vbo);
-	glDeleteVertexArrays(1, &vao);
+	shaderProgram = 0;
+	glDeleteProgram(impostorProgram);
+	impostorProgram = 0;
+	glDeleteBuffers(1, &impostorVBO);
+	glDeleteVertexArrays(1, &impostorVAO);
+	impostorVBO = impostorVAO = 0;
+	for (auto& entry : regionImpostors)
+		glDeleteTextures(1, &entry.second.texture);
+	regionImpostors.clear();
+	glDeleteProgram(objectProgram);
+	objectProgram = 0;
+	glDeleteBuffers(1, &objectBoxVBO);
+	objectBoxVBO = 0;
+	for (auto& entry : regionObjects) {
+		MemoryStats::add(MemoryCategory::GpuBuffers, -(long long)(entry.second.count * sizeof(ObjectInstance)));
+		glDeleteBuffers(1, &entry.second.vbo);
+		glDeleteVertexArrays(1, &entry.second.vao);
+	}
+	regionObjects.clear();
+	for (auto& entry : regionMeshes)
+		deleteMesh(entry.second, entry.second.vertexCount * sizeof(Vertex));
+	regionMeshes.clear();
+	for (PendingUpload& upload : pendingUploads) {
+		MemoryStats::add(MemoryCategory::MeshStaging, -(long long)(upload.verts.capacity() * sizeof(Vertex)));
+		deleteMesh(upload.mesh, upload.verts.size() * sizeof(Vertex));
+	}
+	pendingUploads.clear();
 }
-std::vector<std::string> savedPoints;
-
 void MapRenderer::mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+	requestRedraw();
 	if (button == GLFW_MOUSE_BUTTON_RIGHT)
 		rotating = (action == GLFW_PRESS);
 	if (button == GLFW_MOUSE_BUTTON_MIDDLE)
@@ -291,18 +816,36 @@ void MapRenderer::mouse_button_callback(GLFWwindow* window, int button, int acti
 	if (action == GLFW_RELEASE)
 		firstMouse = true;
 
-	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && !ImGui::GetIO().WantCaptureMouse) {
 		int absX = 50 * 64 + guiHoverTileX;
 		int absY = 50 * 64 + guiHoverTileY;
 
-		char buf[64];
-		snprintf(buf, sizeof(buf), "WorldPoint(%d, %d, 0),", absX, absY);
+		// clicking an existing point picks it up instead of adding a new one
+		PointRef hit;
+		if (savedPaths.nearestPoint(absX, absY, 0, 0, hit)) {
+			savedPaths.setActive(hit.path);
+			selectedPath = hit.path;
+			selectedPoint = hit.index;
+			dragFrom = savedPaths.paths()[hit.path].points[hit.index];
+			dragging = true;
+		}
+		else {
+			editHistory.appendPoint({ absX, absY, 0 });
+			selectedPath = savedPaths.getActiveIndex();
+			selectedPoint = (int)savedPaths.active().points.size() - 1;
+		}
+	}
 
-		savedPoints.push_back(std::string(buf));
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE && dragging) {
+		dragging = false;
+		if (hasSelection())
+			editHistory.movePoint(selectedPath, selectedPoint, dragFrom, savedPaths.paths()[selectedPath].points[selectedPoint]);
 	}
 }
 
 void MapRenderer::mouse_callback(GLFWwindow* window, double xpos, double ypos) {
+	// the hovered tile follows the cursor even when the camera does not move
+	requestRedraw();
 	glfwGetCursorPos(window, &xpos, &ypos);
 	int width, height;
 	glfwGetFramebufferSize(window, &width, &height);
@@ -332,6 +875,7 @@ void MapRenderer::mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 }
 
 void MapRenderer::scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+	requestRedraw();
 	distance -= static_cast<float>(yoffset) * 2.0f;
 	setDistance(distance);
 }
@@ -9,7 +9,16 @@
 
 #include <GLFW/glfw3.h>
 #include "Tile.h"
+#include "PathRenderer.h"
+#include "WorldPoint.h"
+#include "TerrainMesh.h"
+#include "RegionObjects.h"
 #include <string>
+#include <functional>
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+#include <vector>
 
 class MapRenderer {
 public:
@@ -17,7 +26,42 @@ public:
 	void initMap();
 	void renderMap();
 	void cleanupMap();
-	static void uploadTileMesh(Tile*** tiles);
+	// region whose tiles are picked, hovered and edited; others are drawn around it
+	static const int HOME_REGION_X = 50;
+	static const int HOME_REGION_Y = 50;
+
+	// rebuilds a region's mesh and uploads it right away (edits, overlay changes)
+	static void uploadTileMesh(int regionX, int regionY, Tile*** tiles);
+	// the same for many regions (keyed by region id), meshed in parallel on
+	// the job pool and then uploaded in turn
+	static void uploadTileMeshes(const std::unordered_map<int, Tile***>& regions);
+	// takes a mesh built off-thread; it is drawn once uploadPending has sent all of it
+	static void queueRegionMesh(int regionX, int regionY, std::vector<Vertex>&& verts);
+	// uploads queued meshes in slices until byteBudget bytes were sent this call
+	static size_t uploadPending(size_t byteBudget);
+	static bool hasPendingUploads();
+	// adopts a filled vertex buffer (possibly from a shared context) as the region's mesh
+	static void installRegionMesh(int regionX, int regionY, unsigned int buffer, int vertices);
+	// bumped when a region's mesh is rebuilt synchronously or the region is
+	// removed; off-thread uploads taken at an older generation are dropped
+	static unsigned int regionGeneration(int regionX, int regionY);
+	static void setHomeHeights(const float heights[TerrainMesh::SIZE + 1][TerrainMesh::SIZE + 1]);
+	// regions further than this from the camera are drawn as one textured quad
+	static constexpr float IMPOSTOR_DISTANCE = 350.0f;
+	// (re)bakes the region's top-down colour texture and its mip chain; the quad
+	// sits at the region's mean height. Also stands in while the mesh uploads.
+	static void installRegionImpostor(int regionX, int regionY, const unsigned char* rgb,
+		const float heights[TerrainMesh::SIZE + 1][TerrainMesh::SIZE + 1]);
+	static size_t impostorBytes();
+	// one instance per object, drawn as a box shaped by its type and orientation,
+	// in a single instanced draw per region (meshed regions only)
+	static void installRegionObjects(int regionX, int regionY, const RegionObjects& objects,
+		const float heights[TerrainMesh::SIZE + 1][TerrainMesh::SIZE + 1]);
+	static inline bool showObjects = true;
+	// drops everything held for the region: mesh, queued upload, impostor, objects
+	static void removeRegion(int regionX, int regionY);
+	// GPU bytes the region holds (including a queued upload's buffer)
+	static size_t regionGpuBytes(int regionX, int regionY);
 	void resetCamera();
 	static void createShader();
 
@@ -29,13 +73,71 @@ public:
 	static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 	void setTiles(Tile*** newTiles);
 	static inline int vertexCount;
+	static inline unsigned int meshRevision;
+	// optional per-tile colour override applied by uploadTileMesh (world coordinates)
+	static inline std::function<bool(int worldX, int worldY, glm::vec3& color)> tileOverlay;
+	static float terrainHeight(float tileX, float tileY);
+
+	// point picked by clicking on it (or in the point list); dragging moves it
+	static inline int selectedPath = -1;
+	static inline int selectedPoint = -1;
+	static bool hasSelection();
+	static void clearSelection();
+
+	// on-demand rendering: anything that changes the picture asks for a few
+	// frames (ImGui needs a couple to settle hover state). Safe from any thread.
+	static void requestRedraw();
+	static bool takeRedraw();
+	// camera drag or point drag in progress
+	static bool isInteracting();
 
 private:
 	std::string file;
 	GLFWwindow* window;
 	inline static int hoverTileX = -1;
 	inline static int hoverTileY = -1;
+	inline static bool dragging = false;
+	inline static WorldPoint dragFrom = { 0, 0, 0 };
+	inline static std::atomic<int> pendingFrames{ 3 };
+
+	struct RegionMesh {
+		unsigned int vao = 0, vbo = 0;
+		int vertexCount = 0;
+	};
+	struct PendingUpload {
+		int regionX = 0, regionY = 0;
+		RegionMesh mesh;
+		std::vector<Vertex> verts;
+		size_t uploaded = 0;
+	};
+	struct BuiltMesh {
+		int regionX = 0, regionY = 0;
+		std::vector<Vertex> verts;
+		float heights[TerrainMesh::SIZE + 1][TerrainMesh::SIZE + 1];
+		unsigned char colors[TerrainMesh::SIZE * TerrainMesh::SIZE * 3];
+	};
+	struct RegionImpostor {
+		unsigned int texture = 0;
+		float height = 0.0f;
+	};
+	struct ObjectBatch {
+		unsigned int vao = 0, vbo = 0;
+		int count = 0;
+	};
+	// buildTileMesh is safe off the GL thread; installTileMesh is not
+	static void buildTileMesh(int regionX, int regionY, Tile*** tiles, BuiltMesh& out);
+	static void installTileMesh(BuiltMesh& built);
+	static void replaceRegionMesh(int regionX, int regionY, const RegionMesh& mesh);
+	static void deleteMesh(RegionMesh& mesh, size_t bytes);
+	static void createImpostorQuad();
+	static void createObjectBox();
+	inline static std::unordered_map<int, RegionMesh> regionMeshes;
+	inline static std::unordered_map<int, RegionImpostor> regionImpostors;
+	inline static std::unordered_map<int, ObjectBatch> regionObjects;
+	inline static std::deque<PendingUpload> pendingUploads;
+	inline static std::unordered_map<int, unsigned int> regionGenerations;
 	Tile*** tiles = nullptr;
+	PathRenderer pathRenderer;
 };
 
 #endif
\ No newline at end of file
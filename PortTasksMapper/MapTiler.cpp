@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <set>
+#include <tuple>
+#include "MapTiler.h"
+#include "JobSystem.h"
+#include "PngWriter.h"
+#include "Trace.h"
+#include "MemoryStats.h"
+#include "Underlay.h"
+#include "Utils.h"
+
+namespace
+{
+	unsigned int packColor(const glm::vec3& color)
+	{
+		return (unsigned int)(color.r * 255.0f + 0.5f) << 16
+			| (unsigned int)(color.g * 255.0f + 0.5f) << 8
+			| (unsigned int)(color.b * 255.0f + 0.5f);
+	}
+
+	// Caches the last region looked up; neighbouring samples almost always share one.
+	struct RegionCursor
+	{
+		const WorldMap& world;
+		int regionId = -1;
+		RegionRef region;
+
+		explicit RegionCursor(const WorldMap& world) : world(world) {}
+
+		bool at(int x, int y, Tile& out)
+		{
+			int rx = x / WorldMap::REGION_SIZE;
+			int ry = y / WorldMap::REGION_SIZE;
+			int id = WorldMap::regionId(rx, ry);
+			if (id != regionId)
+			{
+				regionId = id;
+				region = world.region(rx, ry);
+			}
+			if (!region)
+				return false;
+			out = region.tile(0, x % WorldMap::REGION_SIZE, y % WorldMap::REGION_SIZE);
+			return true;
+		}
+	};
+}
+
+MapTiler::MapTiler(const WorldMap& world, int pixelsPerTile)
+	: world(world)
+{
+	int scale = 0;
+	while ((1 << scale) < pixelsPerTile && scale < 4)
+		++scale;
+	// WORLD_TILES / TILE_PIXELS = 64 = 2^6 game tiles per pixel at zoom 0
+	deepestZoom = 6 + scale;
+
+	// the colour tables are linear searches; resolve every id once up front
+	int maxUnderlay = 0, maxOverlay = 0;
+	for (int i = 0; i < underlayColorsCount; ++i)
+		maxUnderlay = std::max(maxUnderlay, underlayColors[i].id);
+	for (int i = 0; i < overlayColorsCount; ++i)
+		maxOverlay = std::max(maxOverlay, overlayColors[i].id);
+
+	underlayLut.resize(maxUnderlay + 1);
+	for (int id = 0; id <= maxUnderlay; ++id)
+		underlayLut[id] = packColor(getUnderlayRGB(id));
+	overlayLut.resize(maxOverlay + 1);
+	for (int id = 0; id <= maxOverlay; ++id)
+		overlayLut[id] = packColor(getOverlayRGB(id));
+
+	MemoryStats::add(MemoryCategory::ColorTables, (long long)((underlayLut.size() + overlayLut.size()) * sizeof(unsigned int)));
+}
+
+MapTiler::~MapTiler()
+{
+	MemoryStats::add(MemoryCategory::ColorTables, -(long long)((underlayLut.size() + overlayLut.size()) * sizeof(unsigned int)));
+}
+
+unsigned int MapTiler::tileColor(const Tile& tile) const
+{
+	if (tile.overlayId != 0)
+		return tile.overlayId > 0 && tile.overlayId < (int)overlayLut.size() ? overlayLut[tile.overlayId] : 0;
+	return tile.underlayId > 0 && tile.underlayId < (int)underlayLut.size() ? underlayLut[tile.underlayId] : 0;
+}
+
+std::vector<TileAddress> MapTiler::listTiles() const
+{
+	std::set<std::tuple<int, int, int>> unique;
+	for (int id : world.regionIds())
+	{
+		int rx = WorldMap::regionX(id);
+		int ry = WorldMap::regionY(id);
+		for (int zoom = 0; zoom <= deepestZoom; ++zoom)
+		{
+			// game tiles per output tile at this zoom
+			int span = WORLD_TILES >> zoom;
+			int left = rx * WorldMap::REGION_SIZE;
+			int top = WORLD_TILES - (ry + 1) * WorldMap::REGION_SIZE;
+			for (int tx = left / span; tx <= (left + WorldMap::REGION_SIZE - 1) / span; ++tx)
+				for (int ty = top / span; ty <= (top + WorldMap::REGION_SIZE - 1) / span; ++ty)
+					unique.insert(std::make_tuple(zoom, tx, ty));
+		}
+	}
+
+	std::vector<TileAddress> tiles;
+	tiles.reserve(unique.size());
+	for (const auto& t : unique)
+		tiles.push_back({ std::get<0>(t), std::get<1>(t), std::get<2>(t) });
+	return tiles;
+}
+
+bool MapTiler::renderTile(const TileAddress& tile, unsigned char* rgb) const
+{
+	// pixels per game tile, as a power of two that may be negative
+	int shift = tile.zoom - 6;
+	int samples = shift >= 0 ? 1 : std::min(4, 1 << -shift);
+	double tilesPerPixel = shift >= 0 ? 1.0 / (1 << shift) : (double)(1 << -shift);
+
+	RegionCursor cursor(world);
+	bool any = false;
+	for (int py = 0; py < TILE_PIXELS; ++py)
+	{
+		double top = (double)(tile.y * TILE_PIXELS + py) * tilesPerPixel;
+		for (int px = 0; px < TILE_PIXELS; ++px)
+		{
+			double left = (double)(tile.x * TILE_PIXELS + px) * tilesPerPixel;
+			unsigned int r = 0, g = 0, b = 0, hits = 0;
+			for (int sy = 0; sy < samples; ++sy)
+			{
+				int worldY = WORLD_TILES - 1 - (int)(top + (sy + 0.5) * tilesPerPixel / samples);
+				for (int sx = 0; sx < samples; ++sx)
+				{
+					int worldX = (int)(left + (sx + 0.5) * tilesPerPixel / samples);
+					Tile t;
+					if (!cursor.at(worldX, worldY, t))
+						continue;
+					unsigned int color = tileColor(t);
+					r += color >> 16 & 0xFF;
+					g += color >> 8 & 0xFF;
+					b += color & 0xFF;
+					++hits;
+				}
+			}
+
+			unsigned char* out = rgb + (py * TILE_PIXELS + px) * 3;
+			if (hits)
+			{
+				out[0] = (unsigned char)(r / hits);
+				out[1] = (unsigned char)(g / hits);
+				out[2] = (unsigned char)(b / hits);
+				any = true;
+			}
+			else
+			{
+				out[0] = out[1] = out[2] = 0;
+			}
+		}
+	}
+	return any;
+}
+
+int MapTiler::writeTiles(const std::vector<TileAddress>& tiles, const char* outDir, int threads) const
+{
+	// directories first, so workers only create files
+	std::set<std::pair<int, int>> columns;
+	for (const TileAddress& tile : tiles)
+		columns.insert({ tile.zoom, tile.x });
+	for (const auto& column : columns)
+	{
+		char dir[512];
+		snprintf(dir, sizeof(dir), "%s/%d/%d", outDir, column.first, column.second);
+		std::error_code error;
+		std::filesystem::create_directories(dir, error);
+	}
+
+	std::atomic<int> written(0);
+	parallelFor((int)tiles.size(), threads, [&](int i)
+	{
+		ScratchArena::Scope scope(JobSystem::scratch());
+		unsigned char* rgb = JobSystem::scratch().allocate<unsigned char>(TILE_PIXELS * TILE_PIXELS * 3);
+		{
+			TRACE_SCOPE("renderTile", "tiles");
+			if (!renderTile(tiles[i], rgb))
+				return;
+		}
+
+		char path[512];
+		snprintf(path, sizeof(path), "%s/%d/%d/%d.png", outDir, tiles[i].zoom, tiles[i].x, tiles[i].y);
+		TRACE_SCOPE("writePng", "tiles");
+		if (writePng(path, rgb, TILE_PIXELS, TILE_PIXELS))
+			++written;
+		else
+			fprintf(stderr, "Failed to write %s\n", path);
+	});
+	return written;
+}
+
+int MapTiler::runCommand(int argc, char** argv)
+{
+	const char* mapDir = ".";
+	const char* outDir = "tiles";
+	int pixelsPerTile = 4;
+	int threads = defaultThreadCount();
+
+	for (int i = 2; i + 1 < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--maps"))
+			mapDir = argv[++i];
+		else if (!strcmp(argv[i], "--out"))
+			outDir = argv[++i];
+		else if (!strcmp(argv[i], "--ppt"))
+			pixelsPerTile = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--threads"))
+			threads = std::max(1, atoi(argv[++i]));
+	}
+
+	if (pixelsPerTile < 1 || pixelsPerTile > 16 || (pixelsPerTile & (pixelsPerTile - 1)))
+	{
+		fprintf(stderr, "usage: %s --tiles [--maps dir] [--out dir] [--ppt 1|2|4|8|16] [--threads n]\n", argv[0]);
+		return 2;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	// every region in the directory stays resident, so keep them packed
+	WorldMap world;
+	world.setCompressed(true);
+	std::vector<std::pair<int, int>> loaded = world.loadRegions(WorldMap::listRegions(mapDir), mapDir, threads);
+	if (loaded.empty())
+	{
+		fprintf(stderr, "No regions found in %s\n", mapDir);
+		return 2;
+	}
+
+	MapTiler tiler(world, pixelsPerTile);
+	std::vector<TileAddress> tiles = tiler.listTiles();
+	int written = tiler.writeTiles(tiles, outDir, threads);
+
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("{\"regions\":%d,\"maxZoom\":%d,\"tiles\":%d,\"written\":%d,\"elapsedMs\":%.1f}\n",
+		(int)loaded.size(), tiler.maxZoom(), (int)tiles.size(), written, elapsedMs);
+	return written == (int)tiles.size() ? 0 : 1;
+}
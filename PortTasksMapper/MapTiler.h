@@ -0,0 +1,50 @@
+#ifndef MAPTILER_H
+#define MAPTILER_H
+
+#include <vector>
+#include "WorldMap.h"
+
+struct TileAddress
+{
+	int zoom;
+	int x;
+	int y;
+};
+
+// Rasterizes plane 0 of the loaded regions top-down, using the underlay and
+// overlay colour tables, into a slippy-map pyramid of 256px PNG tiles at
+// <out>/<zoom>/<x>/<y>.png. Zoom 0 covers the whole 256x256 region grid in
+// one tile; the deepest zoom draws pixelsPerTile pixels per game tile.
+// Row 0 is the north edge. Pixels that cover several game tiles average a
+// small grid of samples. No GL context is needed.
+class MapTiler
+{
+public:
+	static const int TILE_PIXELS = 256;
+	static const int WORLD_TILES = 256 * WorldMap::REGION_SIZE;
+
+	// pixelsPerTile must be a power of two between 1 and 16
+	MapTiler(const WorldMap& world, int pixelsPerTile);
+	~MapTiler();
+
+	int maxZoom() const { return deepestZoom; }
+	// Every tile of zoom levels 0..maxZoom() that overlaps a loaded region.
+	std::vector<TileAddress> listTiles() const;
+	// Fills rgb (TILE_PIXELS * TILE_PIXELS * 3 bytes); false if no pixel hit a loaded tile.
+	bool renderTile(const TileAddress& tile, unsigned char* rgb) const;
+	// Renders and encodes the tiles on worker threads; returns the number written.
+	int writeTiles(const std::vector<TileAddress>& tiles, const char* outDir, int threads) const;
+
+	// Entry point for the headless --tiles mode.
+	static int runCommand(int argc, char** argv);
+
+private:
+	unsigned int tileColor(const Tile& tile) const;
+
+	const WorldMap& world;
+	int deepestZoom;
+	std::vector<unsigned int> underlayLut;
+	std::vector<unsigned int> overlayLut;
+};
+
+#endif // MAPTILER_H
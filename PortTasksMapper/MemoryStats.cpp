@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "MemoryStats.h"
+#include "imgui.h"
+
+namespace
+{
+	const int CATEGORIES = (int)MemoryCategory::Count;
+	const char* categoryNames[CATEGORIES] = { "Tiles", "Objects", "Color tables", "Mesh staging", "GPU buffers", "GPU textures", "Paths", "Routing", "UI" };
+
+	std::atomic<long long> currentBytes[CATEGORIES];
+	std::atomic<long long> peakBytes[CATEGORIES];
+
+	void updatePeak(int c, long long value)
+	{
+		long long seen = peakBytes[c].load(std::memory_order_relaxed);
+		while (value > seen && !peakBytes[c].compare_exchange_weak(seen, value, std::memory_order_relaxed))
+			;
+	}
+
+	// each block carries its size in front so frees can be counted
+	const size_t HEADER = 16;
+
+	void* countedAlloc(size_t size, void*)
+	{
+		unsigned char* block = (unsigned char*)malloc(size + HEADER);
+		if (!block)
+			return nullptr;
+		*(size_t*)block = size;
+		MemoryStats::add(MemoryCategory::Ui, (long long)size);
+		return block + HEADER;
+	}
+
+	void countedFree(void* ptr, void*)
+	{
+		if (!ptr)
+			return;
+		unsigned char* block = (unsigned char*)ptr - HEADER;
+		MemoryStats::add(MemoryCategory::Ui, -(long long)*(size_t*)block);
+		free(block);
+	}
+
+	void formatBytes(char* buf, size_t size, long long bytes)
+	{
+		if (bytes >= 1024 * 1024)
+			snprintf(buf, size, "%.1f MB", bytes / (1024.0 * 1024.0));
+		else
+			snprintf(buf, size, "%.1f KB", bytes / 1024.0);
+	}
+}
+
+void MemoryStats::add(MemoryCategory category, long long bytes)
+{
+	int c = (int)category;
+	long long value = currentBytes[c].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	updatePeak(c, value);
+}
+
+void MemoryStats::set(MemoryCategory category, long long bytes)
+{
+	int c = (int)category;
+	currentBytes[c].store(bytes, std::memory_order_relaxed);
+	updatePeak(c, bytes);
+}
+
+long long MemoryStats::current(MemoryCategory category)
+{
+	return currentBytes[(int)category].load(std::memory_order_relaxed);
+}
+
+long long MemoryStats::peak(MemoryCategory category)
+{
+	return peakBytes[(int)category].load(std::memory_order_relaxed);
+}
+
+long long MemoryStats::total()
+{
+	long long sum = 0;
+	for (int c = 0; c < CATEGORIES; ++c)
+		sum += currentBytes[c].load(std::memory_order_relaxed);
+	return sum;
+}
+
+const char* MemoryStats::name(MemoryCategory category)
+{
+	return categoryNames[(int)category];
+}
+
+void MemoryStats::trackImGuiAllocations()
+{
+	ImGui::SetAllocatorFunctions(countedAlloc, countedFree);
+}
+
+void MemoryStats::drawPanel()
+{
+	if (!panelOpen)
+		return;
+
+	ImGui::SetNextWindowPos(ImVec2(570, 430), ImGuiCond_Once);
+	ImGui::SetNextWindowSize(ImVec2(220, 220), ImGuiCond_Once);
+	ImGui::SetNextWindowBgAlpha(0.5f);
+	ImGui::Begin("Memory", &panelOpen, ImGuiWindowFlags_NoCollapse);
+
+	char now[32], high[32];
+	if (ImGui::BeginTable("##memory", 3, ImGuiTableFlags_SizingStretchProp))
+	{
+		ImGui::TableSetupColumn("Subsystem");
+		ImGui::TableSetupColumn("Current");
+		ImGui::TableSetupColumn("Peak");
+		ImGui::TableHeadersRow();
+		for (int c = 0; c < CATEGORIES; ++c)
+		{
+			formatBytes(now, sizeof(now), current((MemoryCategory)c));
+			formatBytes(high, sizeof(high), peak((MemoryCategory)c));
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(categoryNames[c]);
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(now);
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(high);
+		}
+		ImGui::EndTable();
+	}
+
+	formatBytes(now, sizeof(now), total());
+	ImGui::Text("Total: %s", now);
+	ImGui::End();
+}
@@ -0,0 +1,43 @@
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include <atomic>
+
+enum class MemoryCategory
+{
+	Tiles,
+	Objects,
+	ColorTables,
+	MeshStaging,
+	GpuBuffers,
+	GpuTextures,
+	Paths,
+	Routing,
+	Ui,
+	Count
+};
+
+// Bytes held per subsystem. Owners report allocations and releases as they
+// happen (add), or the current size of structures that are cheaper to
+// measure than to track (set). Peaks are kept so short-lived staging
+// buffers still show up. All counters are safe to update from any thread.
+class MemoryStats
+{
+public:
+	static void add(MemoryCategory category, long long bytes);
+	static void set(MemoryCategory category, long long bytes);
+
+	static long long current(MemoryCategory category);
+	static long long peak(MemoryCategory category);
+	static long long total();
+	static const char* name(MemoryCategory category);
+
+	// Routes ImGui's allocations through counters for the Ui category;
+	// must be called before ImGui::CreateContext.
+	static void trackImGuiAllocations();
+	static void drawPanel();
+
+	static inline bool panelOpen = false;
+};
+
+#endif // MEMORYSTATS_H
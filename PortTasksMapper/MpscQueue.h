@@ -0,0 +1,62 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded multi-producer, single-consumer FIFO (Vyukov's linked queue).
+// push never blocks or spins; pop is only ever called from one thread. A
+// push that is still linking its node may briefly be invisible to pop.
+template <typename T>
+class MpscQueue
+{
+public:
+	MpscQueue()
+	{
+		Node* stub = new Node();
+		head.store(stub, std::memory_order_relaxed);
+		tail = stub;
+	}
+
+	~MpscQueue()
+	{
+		T discard;
+		while (pop(discard))
+			;
+		delete tail;
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	void push(T value)
+	{
+		Node* node = new Node();
+		node->value = std::move(value);
+		Node* previous = head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	bool pop(T& out)
+	{
+		Node* next = tail->next.load(std::memory_order_acquire);
+		if (!next)
+			return false;
+		out = std::move(next->value);
+		delete tail;
+		tail = next;
+		return true;
+	}
+
+private:
+	struct Node
+	{
+		std::atomic<Node*> next{ nullptr };
+		T value{};
+	};
+
+	std::atomic<Node*> head;
+	Node* tail;
+};
+
+#endif // MPSCQUEUE_H
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <unordered_map>
+#include "PackedRegion.h"
+#include "MapLoader.h"
+
+namespace
+{
+	const int BLOCKS_PER_SIDE = PackedRegion::SIZE / PackedRegion::BLOCK;
+	const int BLOCK_TILES = PackedRegion::BLOCK * PackedRegion::BLOCK;
+
+	int bitsFor(uint32_t range)
+	{
+		int bits = 0;
+		while (bits < 32 && (range >> bits) != 0)
+			++bits;
+		return bits;
+	}
+}
+
+// attrOpcode, settings, overlay id, underlay id, overlay path and rotation
+// in 8 + 8 + 16 + 16 + 8 + 8 bits; decoded opcodes are at most 49
+uint64_t PackedRegion::packCode(const Tile& tile)
+{
+	return (uint64_t)(tile.attrOpcode & 0xFF)
+		| (uint64_t)tile.settings << 8
+		| (uint64_t)(uint16_t)tile.overlayId << 16
+		| (uint64_t)(uint16_t)tile.underlayId << 32
+		| (uint64_t)tile.overlayPath << 48
+		| (uint64_t)tile.overlayRotation << 56;
+}
+
+void PackedRegion::unpackCode(uint64_t code, Tile& out)
+{
+	out.attrOpcode = (int)(code & 0xFF);
+	out.settings = (unsigned char)(code >> 8);
+	out.overlayId = (short)(uint16_t)(code >> 16);
+	out.underlayId = (short)(uint16_t)(code >> 32);
+	out.overlayPath = (unsigned char)(code >> 48);
+	out.overlayRotation = (unsigned char)(code >> 56);
+}
+
+uint32_t PackedRegion::readBits(const std::vector<uint64_t>& words, size_t bit, int width)
+{
+	size_t word = bit >> 6;
+	int shift = (int)(bit & 63);
+	uint64_t value = words[word] >> shift;
+	if (shift + width > 64)
+		value |= words[word + 1] << (64 - shift);
+	return (uint32_t)(value & ((1ull << width) - 1));
+}
+
+void PackedRegion::writeBits(std::vector<uint64_t>& words, size_t bit, int width, uint32_t value)
+{
+	size_t word = bit >> 6;
+	int shift = (int)(bit & 63);
+	words[word] |= (uint64_t)value << shift;
+	if (shift + width > 64)
+		words[word + 1] |= (uint64_t)value >> (64 - shift);
+}
+
+PackedRegion::PackedRegion(Tile*** tiles)
+{
+	std::unordered_map<uint64_t, uint16_t> paletteIndex;
+	uint64_t lastCode = 0;
+	uint16_t lastIndex = 0xFFFF;
+	auto intern = [&](const Tile& tile)
+	{
+		// neighbouring tiles mostly repeat, so skip the hash lookup for runs
+		uint64_t code = packCode(tile);
+		if (lastIndex != 0xFFFF && code == lastCode)
+			return lastIndex;
+		lastCode = code;
+		auto it = paletteIndex.find(code);
+		if (it != paletteIndex.end())
+			return lastIndex = it->second;
+		uint16_t index = (uint16_t)palette.size();
+		paletteIndex.emplace(code, index);
+		palette.push_back(code);
+		return lastIndex = index;
+	};
+
+	// pass 1: per block minimum and width of both streams
+	std::vector<Block> all(4 * BLOCKS_PER_SIDE * BLOCKS_PER_SIDE);
+	std::vector<uint16_t> indices(4 * SIZE * SIZE);
+	for (int plane = 0; plane < 4; ++plane)
+	{
+		for (int x = 0; x < SIZE; ++x)
+			for (int y = 0; y < SIZE; ++y)
+				indices[(plane * SIZE + x) * SIZE + y] = intern(tiles[plane][x][y]);
+
+		for (int b = 0; b < BLOCKS_PER_SIDE * BLOCKS_PER_SIDE; ++b)
+		{
+			int bx = b / BLOCKS_PER_SIDE * BLOCK;
+			int by = b % BLOCKS_PER_SIDE * BLOCK;
+			int minHeight = tiles[plane][bx][by].height, maxHeight = minHeight;
+			uint16_t minCode = indices[(plane * SIZE + bx) * SIZE + by], maxCode = minCode;
+			for (int x = bx; x < bx + BLOCK; ++x)
+			{
+				for (int y = by; y < by + BLOCK; ++y)
+				{
+					minHeight = std::min(minHeight, tiles[plane][x][y].height);
+					maxHeight = std::max(maxHeight, tiles[plane][x][y].height);
+					minCode = std::min(minCode, indices[(plane * SIZE + x) * SIZE + y]);
+					maxCode = std::max(maxCode, indices[(plane * SIZE + x) * SIZE + y]);
+				}
+			}
+			Block& block = all[plane * BLOCKS_PER_SIDE * BLOCKS_PER_SIDE + b];
+			block.heightBase = minHeight;
+			block.heightBits = (uint8_t)bitsFor((uint32_t)(maxHeight - minHeight));
+			block.codeBase = minCode;
+			block.codeBits = (uint8_t)bitsFor((uint32_t)(maxCode - minCode));
+		}
+	}
+
+	// pass 2: collapse uniform planes (and a uniform region), then pack the rest
+	auto sameUniform = [](const Block& a, const Block& b)
+	{
+		return a.heightBits == 0 && a.codeBits == 0 && b.heightBits == 0 && b.codeBits == 0
+			&& a.heightBase == b.heightBase && a.codeBase == b.codeBase;
+	};
+	size_t totalBits = 0;
+	for (int plane = 0; plane < 4; ++plane)
+	{
+		const Block* first = &all[plane * BLOCKS_PER_SIDE * BLOCKS_PER_SIDE];
+		bool uniform = std::all_of(first, first + BLOCKS_PER_SIDE * BLOCKS_PER_SIDE,
+			[&](const Block& block) { return sameUniform(block, *first); });
+		if (uniform)
+		{
+			// empty upper planes usually match each other; they share one block
+			uniformPlanes |= 1 << plane;
+			auto shared = std::find_if(blocks.begin(), blocks.end(),
+				[&](const Block& block) { return sameUniform(block, *first); });
+			if (shared != blocks.end())
+			{
+				planeBlock[plane] = (uint16_t)(shared - blocks.begin());
+				continue;
+			}
+		}
+
+		planeBlock[plane] = (uint16_t)blocks.size();
+		int count = uniform ? 1 : BLOCKS_PER_SIDE * BLOCKS_PER_SIDE;
+		for (int b = 0; b < count; ++b)
+		{
+			Block block = first[b];
+			block.heightWord = (uint32_t)(totalBits >> 6);
+			totalBits += ((size_t)block.heightBits * BLOCK_TILES + 63) & ~(size_t)63;
+			block.codeWord = (uint32_t)(totalBits >> 6);
+			totalBits += ((size_t)block.codeBits * BLOCK_TILES + 63) & ~(size_t)63;
+			blocks.push_back(block);
+		}
+	}
+
+	bits.assign(totalBits >> 6, 0);
+	for (int plane = 0; plane < 4; ++plane)
+	{
+		if (uniformPlanes & (1 << plane))
+			continue;
+		for (int b = 0; b < BLOCKS_PER_SIDE * BLOCKS_PER_SIDE; ++b)
+		{
+			const Block& block = blocks[planeBlock[plane] + b];
+			int bx = b / BLOCKS_PER_SIDE * BLOCK;
+			int by = b % BLOCKS_PER_SIDE * BLOCK;
+			for (int x = 0; x < BLOCK; ++x)
+			{
+				for (int y = 0; y < BLOCK; ++y)
+				{
+					int local = x * BLOCK + y;
+					if (block.heightBits)
+						writeBits(bits, ((size_t)block.heightWord << 6) + (size_t)local * block.heightBits, block.heightBits,
+							(uint32_t)(tiles[plane][bx + x][by + y].height - block.heightBase));
+					if (block.codeBits)
+						writeBits(bits, ((size_t)block.codeWord << 6) + (size_t)local * block.codeBits, block.codeBits,
+							(uint32_t)(indices[(plane * SIZE + bx + x) * SIZE + by + y] - block.codeBase));
+				}
+			}
+		}
+	}
+	palette.shrink_to_fit();
+}
+
+Tile PackedRegion::tile(int plane, int x, int y) const
+{
+	const Block* block = &blocks[planeBlock[plane]];
+	if (!(uniformPlanes & (1 << plane)))
+		block += x / BLOCK * BLOCKS_PER_SIDE + y / BLOCK;
+	int local = x % BLOCK * BLOCK + y % BLOCK;
+
+	Tile out;
+	out.height = block->heightBase;
+	if (block->heightBits)
+		out.height += (int)readBits(bits, ((size_t)block->heightWord << 6) + (size_t)local * block->heightBits, block->heightBits);
+	uint32_t index = block->codeBase;
+	if (block->codeBits)
+		index += readBits(bits, ((size_t)block->codeWord << 6) + (size_t)local * block->codeBits, block->codeBits);
+	unpackCode(palette[index], out);
+	return out;
+}
+
+Tile*** PackedRegion::unpack() const
+{
+	// an empty buffer decodes to zeroed tiles, allocated and accounted like any region
+	Tile*** tiles = MapLoader::loadTerrain(nullptr, 0);
+	for (int plane = 0; plane < 4; ++plane)
+		for (int x = 0; x < SIZE; ++x)
+			for (int y = 0; y < SIZE; ++y)
+				tiles[plane][x][y] = tile(plane, x, y);
+	return tiles;
+}
+
+size_t PackedRegion::memoryBytes() const
+{
+	return sizeof(PackedRegion) + palette.capacity() * sizeof(uint64_t)
+		+ blocks.capacity() * sizeof(Block) + bits.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,57 @@
+#ifndef PACKEDREGION_H
+#define PACKEDREGION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Tile.h"
+
+// Read-only compressed copy of a decoded region, for keeping the whole world
+// resident. Every tile is split into its height and a 64-bit code of the
+// remaining fields; codes are interned in a per-region palette. Each plane
+// is cut into 16x16 blocks that store heights and palette indices as
+// offsets from the block minimum, bit-packed at the narrowest width that
+// fits, so flat or single-material blocks take no per-tile bits at all.
+// Planes whose blocks are all the same uniform value collapse to one block,
+// and a region that is uniform throughout to a single block shared by all
+// four planes. Any tile can be read in constant time.
+class PackedRegion
+{
+public:
+	static const int SIZE = 64;
+	static const int BLOCK = 16;
+
+	explicit PackedRegion(Tile*** tiles);
+
+	Tile tile(int plane, int x, int y) const;
+	// full Tile*** copy, as MapLoader::loadTerrain returns it
+	Tile*** unpack() const;
+
+	bool isUniform() const { return blocks.size() == 1; }
+	size_t memoryBytes() const;
+
+private:
+	struct Block
+	{
+		uint32_t heightWord = 0;  // first word of the height bits
+		uint32_t codeWord = 0;    // first word of the palette index bits
+		int32_t heightBase = 0;
+		uint16_t codeBase = 0;
+		uint8_t heightBits = 0;   // 0: every tile has heightBase
+		uint8_t codeBits = 0;     // 0: every tile is palette[codeBase]
+	};
+
+	static uint64_t packCode(const Tile& tile);
+	static void unpackCode(uint64_t code, Tile& out);
+	static uint32_t readBits(const std::vector<uint64_t>& words, size_t bit, int width);
+	static void writeBits(std::vector<uint64_t>& words, size_t bit, int width, uint32_t value);
+
+	std::vector<uint64_t> palette;
+	std::vector<Block> blocks;
+	std::vector<uint64_t> bits;
+	// index of each plane's first block; a uniform plane has a single block
+	uint16_t planeBlock[4] = {};
+	uint8_t uniformPlanes = 0;
+};
+
+#endif // PACKEDREGION_H
@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include "Path.h"
+#include "Utils.h"
+
+PathSet savedPaths;
+
+PathSet::PathSet()
+{
+	addPath("Path 1");
+}
+
+void PathSet::setActive(int index)
+{
+	if (index >= 0 && index < (int)pathList.size())
+		activeIndex = index;
+}
+
+size_t PathSet::memoryBytes() const
+{
+	size_t bytes = pathList.capacity() * sizeof(Path) + pointIndex.memoryBytes();
+	bytes += pathIds.capacity() * sizeof(unsigned int) + pointIds.capacity() * sizeof(std::vector<unsigned int>);
+	for (const Path& path : pathList)
+		bytes += path.name.capacity() + path.points.capacity() * sizeof(WorldPoint);
+	for (const std::vector<unsigned int>& ids : pointIds)
+		bytes += ids.capacity() * sizeof(unsigned int);
+	return bytes;
+}
+
+// linear in the path's length, but only paid per lookup result, never per edit
+bool PathSet::resolve(const PointKey& key, PointRef& out) const
+{
+	auto path = std::find(pathIds.begin(), pathIds.end(), key.path);
+	if (path == pathIds.end())
+		return false;
+	out.path = (int)(path - pathIds.begin());
+
+	const std::vector<unsigned int>& ids = pointIds[out.path];
+	auto point = std::find(ids.begin(), ids.end(), key.point);
+	if (point == ids.end())
+		return false;
+	out.index = (int)(point - ids.begin());
+	return true;
+}
+
+void PathSet::queryPoints(int x, int y, int plane, int radius, std::vector<PointRef>& out) const
+{
+	std::vector<PointKey> keys;
+	pointIndex.query(x, y, plane, radius, keys);
+	for (const PointKey& key : keys)
+	{
+		PointRef ref;
+		if (resolve(key, ref))
+			out.push_back(ref);
+	}
+}
+
+bool PathSet::nearestPoint(int x, int y, int plane, int radius, PointRef& out) const
+{
+	PointKey key;
+	return pointIndex.nearest(x, y, plane, radius, key) && resolve(key, out);
+}
+
+int PathSet::addPath(const std::string& name)
+{
+	pathList.push_back({ name, {} });
+	pathIds.push_back(nextId++);
+	pointIds.emplace_back();
+	activeIndex = (int)pathList.size() - 1;
+	touch();
+	return activeIndex;
+}
+
+void PathSet::removePath(int index)
+{
+	const std::vector<WorldPoint>& removed = pathList[index].points;
+	for (int i = 0; i < (int)removed.size(); ++i)
+		pointIndex.erase(removed[i], { pathIds[index], pointIds[index][i] });
+
+	pathList.erase(pathList.begin() + index);
+	pathIds.erase(pathIds.begin() + index);
+	pointIds.erase(pointIds.begin() + index);
+	if (pathList.empty())
+		addPath("Path 1");
+	if (activeIndex >= (int)pathList.size())
+		activeIndex = (int)pathList.size() - 1;
+	touch();
+}
+
+void PathSet::append(const WorldPoint& point)
+{
+	insertPoint(activeIndex, (int)pathList[activeIndex].points.size(), point);
+}
+
+void PathSet::setPoints(const std::vector<WorldPoint>& points)
+{
+	setPoints(activeIndex, points);
+}
+
+void PathSet::insertPoint(int path, int index, const WorldPoint& point)
+{
+	std::vector<WorldPoint>& points = pathList[path].points;
+	std::vector<unsigned int>& ids = pointIds[path];
+	unsigned int id = nextId++;
+	points.insert(points.begin() + index, point);
+	ids.insert(ids.begin() + index, id);
+	pointIndex.insert(point, { pathIds[path], id });
+	touch();
+}
+
+void PathSet::erasePoint(int path, int index)
+{
+	std::vector<WorldPoint>& points = pathList[path].points;
+	std::vector<unsigned int>& ids = pointIds[path];
+	pointIndex.erase(points[index], { pathIds[path], ids[index] });
+	points.erase(points.begin() + index);
+	ids.erase(ids.begin() + index);
+	touch();
+}
+
+void PathSet::setPoint(int path, int index, const WorldPoint& point)
+{
+	WorldPoint& current = pathList[path].points[index];
+	pointIndex.move(current, point, { pathIds[path], pointIds[path][index] });
+	current = point;
+	touch();
+}
+
+void PathSet::setPoints(int path, const std::vector<WorldPoint>& points)
+{
+	std::vector<WorldPoint>& current = pathList[path].points;
+	std::vector<unsigned int>& ids = pointIds[path];
+	for (int i = 0; i < (int)current.size(); ++i)
+		pointIndex.erase(current[i], { pathIds[path], ids[i] });
+
+	current = points;
+	ids.resize(current.size());
+	for (int i = 0; i < (int)current.size(); ++i)
+	{
+		ids[i] = nextId++;
+		pointIndex.insert(current[i], { pathIds[path], ids[i] });
+	}
+	touch();
+}
+
+int formatWorldPoint(const WorldPoint& point, char* buf, size_t size)
+{
+	return snprintf(buf, size, "WorldPoint(%d, %d, %d),", point.x, point.y, point.plane);
+}
+
+std::string formatPath(const Path& path)
+{
+	std::string text;
+	text.reserve(path.points.size() * 26);
+
+	char buf[64];
+	for (const WorldPoint& p : path.points)
+	{
+		formatWorldPoint(p, buf, sizeof(buf));
+		text += buf;
+		text += '\n';
+	}
+	return text;
+}
+
+namespace
+{
+	std::string trimmed(const char* begin, const char* end)
+	{
+		while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '/' || *begin == '*'))
+			++begin;
+		while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+			--end;
+		return std::string(begin, end);
+	}
+
+	bool parseWorldPoint(const char* line, const char* end, WorldPoint& out)
+	{
+		static const char token[] = "WorldPoint(";
+		const size_t tokenLen = sizeof(token) - 1;
+
+		for (const char* p = line; p + tokenLen <= end; ++p)
+		{
+			if (memcmp(p, token, tokenLen) != 0)
+				continue;
+
+			std::string args(p + tokenLen, end);
+			char* cursor = &args[0];
+			int values[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				char* next;
+				values[i] = (int)strtol(cursor, &next, 10);
+				if (next == cursor)
+					return false;
+				cursor = next;
+				while (*cursor == ' ' || *cursor == '\t')
+					++cursor;
+				if (i < 2 && *cursor++ != ',')
+					return false;
+			}
+			out = { values[0], values[1], values[2] };
+			return true;
+		}
+		return false;
+	}
+}
+
+std::vector<Path> parsePaths(const char* text, size_t len, const std::string& fallbackName)
+{
+	std::vector<Path> paths;
+	std::string label;
+	bool inRun = false;
+
+	const char* end = text + len;
+	for (const char* line = text; line < end;)
+	{
+		const char* eol = (const char*)memchr(line, '\n', end - line);
+		if (!eol)
+			eol = end;
+
+		WorldPoint point;
+		if (parseWorldPoint(line, eol, point))
+		{
+			if (!inRun)
+			{
+				std::string name = label.empty() ? fallbackName + "#" + std::to_string(paths.size() + 1) : label;
+				paths.push_back({ name, {} });
+				label.clear();
+				inRun = true;
+			}
+			paths.back().points.push_back(point);
+		}
+		else
+		{
+			// closing braces and other punctuation do not end a run or name one
+			std::string content = trimmed(line, eol);
+			bool hasText = false;
+			for (char c : content)
+				hasText = hasText || isalnum((unsigned char)c);
+			if (hasText)
+			{
+				inRun = false;
+				label = content;
+			}
+		}
+		line = eol + 1;
+	}
+	return paths;
+}
+
+bool loadPathFile(const char* filename, std::vector<Path>& out)
+{
+	size_t size;
+	unsigned char* buf = loadFileBytes(filename, &size);
+	if (!buf) return false;
+
+	out = parsePaths((const char*)buf, size, filename);
+	free(buf);
+	return true;
+}
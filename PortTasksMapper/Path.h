@@ -0,0 +1,75 @@
+#ifndef PATH_H
+#define PATH_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "WorldPoint.h"
+#include "PointIndex.h"
+
+struct Path
+{
+	std::string name;
+	std::vector<WorldPoint> points;
+};
+
+// All paths being edited. Points are kept as plain coordinates and only
+// turned into plugin text when something actually needs the text.
+class PathSet
+{
+public:
+	PathSet();
+
+	// read-only so every change goes through the methods below and keeps
+	// the point index in sync
+	const std::vector<Path>& paths() const { return pathList; }
+	const Path& active() const { return pathList[activeIndex]; }
+	const PointIndex& index() const { return pointIndex; }
+	// index lookups resolved to path and point positions
+	void queryPoints(int x, int y, int plane, int radius, std::vector<PointRef>& out) const;
+	bool nearestPoint(int x, int y, int plane, int radius, PointRef& out) const;
+
+	int getActiveIndex() const { return activeIndex; }
+	void setActive(int index);
+
+	int addPath(const std::string& name);
+	void removePath(int index);
+	void append(const WorldPoint& point);
+	void setPoints(const std::vector<WorldPoint>& points);
+
+	void insertPoint(int path, int index, const WorldPoint& point);
+	void erasePoint(int path, int index);
+	void setPoint(int path, int index, const WorldPoint& point);
+	void setPoints(int path, const std::vector<WorldPoint>& points);
+
+	// bumped on every change so views can rebuild cached data lazily
+	unsigned int revision() const { return revisionCounter; }
+	void touch() { ++revisionCounter; }
+	// point storage, names and the point index
+	size_t memoryBytes() const;
+
+private:
+	bool resolve(const PointKey& key, PointRef& out) const;
+
+	std::vector<Path> pathList;
+	// stable ids parallel to pathList and to each path's points
+	std::vector<unsigned int> pathIds;
+	std::vector<std::vector<unsigned int>> pointIds;
+	unsigned int nextId = 0;
+	PointIndex pointIndex;
+	int activeIndex = 0;
+	unsigned int revisionCounter = 0;
+};
+
+int formatWorldPoint(const WorldPoint& point, char* buf, size_t size);
+std::string formatPath(const Path& path);
+
+// Reads every WorldPoint(x, y, plane) in plugin source text. A run of
+// WorldPoint lines, uninterrupted by any line with text on it, is one path,
+// named after the comment or declaration line before it (or "<name>#<n>").
+std::vector<Path> parsePaths(const char* text, size_t len, const std::string& fallbackName);
+bool loadPathFile(const char* filename, std::vector<Path>& out);
+
+extern PathSet savedPaths;
+
+#endif // PATH_H
@@ -0,0 +1,205 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "PathExporter.h"
+
+namespace
+{
+	class BufferedWriter
+	{
+	public:
+		explicit BufferedWriter(FILE* file) : file(file) {}
+		~BufferedWriter() { flush(); }
+
+		void put(char c)
+		{
+			if (used == sizeof(buffer))
+				flush();
+			buffer[used++] = c;
+		}
+
+		void put(const char* data, size_t len)
+		{
+			if (used + len > sizeof(buffer))
+				flush();
+			if (len > sizeof(buffer))
+			{
+				ok = ok && fwrite(data, 1, len, file) == len;
+				return;
+			}
+			memcpy(buffer + used, data, len);
+			used += len;
+		}
+
+		void put(const char* text) { put(text, strlen(text)); }
+
+		void putInt(int value)
+		{
+			char digits[12];
+			int n = 0;
+			unsigned int v = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+			do
+			{
+				digits[n++] = (char)('0' + v % 10);
+				v /= 10;
+			} while (v);
+			if (value < 0)
+				put('-');
+			while (n)
+				put(digits[--n]);
+		}
+
+		void putU16(unsigned int v) { put((char)(v & 0xFF)); put((char)(v >> 8 & 0xFF)); }
+		void putU32(unsigned int v) { putU16(v & 0xFFFF); putU16(v >> 16); }
+
+		void putVarint(int value)
+		{
+			unsigned int v = ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+			while (v >= 0x80)
+			{
+				put((char)(v | 0x80));
+				v >>= 7;
+			}
+			put((char)v);
+		}
+
+		bool flush()
+		{
+			if (used)
+				ok = ok && fwrite(buffer, 1, used, file) == used;
+			used = 0;
+			return ok;
+		}
+
+	private:
+		FILE* file;
+		char buffer[1 << 16];
+		size_t used = 0;
+		bool ok = true;
+	};
+
+	void writeJava(BufferedWriter& out, const std::vector<Path>& paths)
+	{
+		for (const Path& path : paths)
+		{
+			out.put("// ");
+			out.put(path.name.c_str());
+			out.put('\n');
+			for (const WorldPoint& p : path.points)
+			{
+				out.put("WorldPoint(");
+				out.putInt(p.x);
+				out.put(", ");
+				out.putInt(p.y);
+				out.put(", ");
+				out.putInt(p.plane);
+				out.put("),\n");
+			}
+			out.put('\n');
+		}
+	}
+
+	void writeJsonString(BufferedWriter& out, const std::string& text)
+	{
+		out.put('"');
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				out.put('\\');
+				out.put(c);
+			}
+			else if ((unsigned char)c < 0x20)
+			{
+				char esc[8];
+				snprintf(esc, sizeof(esc), "\\u%04x", c);
+				out.put(esc);
+			}
+			else
+			{
+				out.put(c);
+			}
+		}
+		out.put('"');
+	}
+
+	void writeJson(BufferedWriter& out, const std::vector<Path>& paths)
+	{
+		const std::vector<Path>& list = paths;
+		out.put("{\"paths\":[");
+		for (size_t i = 0; i < list.size(); ++i)
+		{
+			out.put(i ? ",\n{\"name\":" : "\n{\"name\":");
+			writeJsonString(out, list[i].name);
+			out.put(",\"points\":[");
+			const std::vector<WorldPoint>& points = list[i].points;
+			for (size_t p = 0; p < points.size(); ++p)
+			{
+				out.put(p ? ",[" : "[");
+				out.putInt(points[p].x);
+				out.put(',');
+				out.putInt(points[p].y);
+				out.put(',');
+				out.putInt(points[p].plane);
+				out.put(']');
+			}
+			out.put("]}");
+		}
+		out.put("\n]}\n");
+	}
+
+	void writeBinary(BufferedWriter& out, const std::vector<Path>& paths)
+	{
+		const std::vector<Path>& list = paths;
+		out.put("PTMP", 4);
+		out.putU16(PathExporter::BINARY_VERSION);
+		out.putU32((unsigned int)list.size());
+		for (const Path& path : list)
+		{
+			size_t nameLength = path.name.size() > 0xFFFF ? 0xFFFF : path.name.size();
+			out.putU16((unsigned int)nameLength);
+			out.put(path.name.data(), nameLength);
+			out.putU32((unsigned int)path.points.size());
+
+			WorldPoint last = { 0, 0, 0 };
+			for (const WorldPoint& p : path.points)
+			{
+				out.putVarint(p.x - last.x);
+				out.putVarint(p.y - last.y);
+				out.put((char)p.plane);
+				last = p;
+			}
+		}
+	}
+}
+
+bool PathExporter::write(const std::vector<Path>& paths, const char* filename, ExportFormat format)
+{
+	FILE* file = fopen(filename, format == ExportFormat::Binary ? "wb" : "w");
+	if (!file) return false;
+
+	bool ok;
+	{
+		BufferedWriter out(file);
+		switch (format)
+		{
+		case ExportFormat::Java: writeJava(out, paths); break;
+		case ExportFormat::Json: writeJson(out, paths); break;
+		case ExportFormat::Binary: writeBinary(out, paths); break;
+		}
+		ok = out.flush();
+	}
+
+	return fclose(file) == 0 && ok;
+}
+
+bool PathExporter::writeAll(const std::vector<Path>& paths, const char* basePath)
+{
+	std::string base(basePath);
+	bool ok = write(paths, (base + ".java").c_str(), ExportFormat::Java);
+	ok = write(paths, (base + ".json").c_str(), ExportFormat::Json) && ok;
+	ok = write(paths, (base + ".bin").c_str(), ExportFormat::Binary) && ok;
+	return ok;
+}
@@ -0,0 +1,31 @@
+#ifndef PATHEXPORTER_H
+#define PATHEXPORTER_H
+
+#include "Path.h"
+
+enum class ExportFormat
+{
+	Java,
+	Json,
+	Binary
+};
+
+// Streams a path set to disk through a fixed-size buffer; the document is
+// never assembled in memory.
+//
+// Binary layout (little endian):
+//   "PTMP" u16 version u32 pathCount
+//   per path: u16 nameLength, name bytes, u32 pointCount,
+//             per point: zigzag varint dx, zigzag varint dy, u8 plane
+//   where dx/dy are relative to the previous point (0, 0 for the first).
+class PathExporter
+{
+public:
+	static const unsigned short BINARY_VERSION = 1;
+
+	static bool write(const std::vector<Path>& paths, const char* filename, ExportFormat format);
+	// writes <basePath>.java, <basePath>.json and <basePath>.bin
+	static bool writeAll(const std::vector<Path>& paths, const char* basePath);
+};
+
+#endif // PATHEXPORTER_H
@@ -0,0 +1,228 @@
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "Path.h"
+#include "PathRenderer.h"
+#include "MapRenderer.h"
+#include "FrameProfiler.h"
+#include "Trace.h"
+#include "MemoryStats.h"
+
+struct PathVertex {
+	float x, y, z;
+	float r, g, b;
+};
+
+namespace {
+	const float tileSize = 4.0f;
+	const float lift = 0.4f;
+	const float markerSize = 0.8f;
+	const int regionBaseX = 50 * 64;
+	const int regionBaseY = 50 * 64;
+
+	// tile-space position (tile centres at +0.5) to scene space, draped on the mesh
+	glm::vec3 toScene(float tileX, float tileY) {
+		float h = MapRenderer::terrainHeight(tileX, tileY);
+		return glm::vec3(tileX * tileSize, h + lift, (63.0f - tileY) * tileSize);
+	}
+
+	glm::vec3 pathColor(int index, bool active) {
+		if (active)
+			return glm::vec3(1.0f, 1.0f, 0.0f);
+		float hue = std::fmod(index * 0.618034f, 1.0f) * 6.0f;
+		float f = hue - std::floor(hue);
+		switch ((int)hue) {
+		case 0: return glm::vec3(1.0f, f, 0.2f);
+		case 1: return glm::vec3(1.0f - f, 1.0f, 0.2f);
+		case 2: return glm::vec3(0.2f, 1.0f, f);
+		case 3: return glm::vec3(0.2f, 1.0f - f, 1.0f);
+		case 4: return glm::vec3(f, 0.2f, 1.0f);
+		default: return glm::vec3(1.0f, 0.2f, 1.0f - f);
+		}
+	}
+}
+
+void PathRenderer::init() {
+	const char* vertSrc = R"(
+        #version 330 core
+        layout (location = 0) in vec3 aPos;
+        layout (location = 1) in vec3 aColor;
+        layout (location = 2) in vec3 aOffset;
+        uniform mat4 uVP;
+        out vec3 vColor;
+        void main() {
+            gl_Position = uVP * vec4(aPos + aOffset, 1.0);
+            vColor = aColor;
+        }
+    )";
+
+	const char* fragSrc = R"(
+        #version 330 core
+        in vec3 vColor;
+        out vec4 FragColor;
+        void main() {
+            FragColor = vec4(vColor, 1.0);
+        }
+    )";
+
+	GLuint vert = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vert, 1, &vertSrc, nullptr);
+	glCompileShader(vert);
+
+	GLuint frag = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(frag, 1, &fragSrc, nullptr);
+	glCompileShader(frag);
+
+	program = glCreateProgram();
+	glAttachShader(program, vert);
+	glAttachShader(program, frag);
+	glLinkProgram(program);
+
+	glDeleteShader(vert);
+	glDeleteShader(frag);
+
+	// lines: per-vertex position and colour, no offset
+	glGenVertexArrays(1, &lineVao);
+	glGenBuffers(1, &lineVbo);
+	glBindVertexArray(lineVao);
+	glBindBuffer(GL_ARRAY_BUFFER, lineVbo);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PathVertex), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(PathVertex), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	glDisableVertexAttribArray(2);
+
+	// markers: a small 3D cross shared by every instance, which supplies
+	// its own position and colour
+	const float s = markerSize;
+	const float cross[] = {
+		-s, 0, 0,  s, 0, 0,
+		 0, -s, 0, 0, s, 0,
+		 0, 0, -s, 0, 0, s,
+	};
+	glGenVertexArrays(1, &markerVao);
+	glGenBuffers(1, &markerVbo);
+	glGenBuffers(1, &instanceVbo);
+	glBindVertexArray(markerVao);
+	glBindBuffer(GL_ARRAY_BUFFER, markerVbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(cross), cross, GL_STATIC_DRAW);
+	gpuBytes = sizeof(cross);
+	MemoryStats::add(MemoryCategory::GpuBuffers, gpuBytes);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(PathVertex), (void*)0);
+	glEnableVertexAttribArray(2);
+	glVertexAttribDivisor(2, 1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(PathVertex), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+
+	glBindVertexArray(0);
+}
+
+void PathRenderer::rebuild(const PathSet& paths, int selectedPath, int selectedPoint) {
+	TRACE_SCOPE("pathRebuild", "mesh");
+	std::vector<PathVertex> lines;
+	std::vector<PathVertex> markers;
+
+	const std::vector<Path>& list = paths.paths();
+	for (int i = 0; i < (int)list.size(); ++i) {
+		const std::vector<WorldPoint>& points = list[i].points;
+		glm::vec3 c = pathColor(i, i == paths.getActiveIndex());
+
+		for (size_t p = 0; p < points.size(); ++p) {
+			float tx = points[p].x - regionBaseX + 0.5f;
+			float ty = points[p].y - regionBaseY + 0.5f;
+			glm::vec3 pos = toScene(tx, ty);
+			if (i == selectedPath && (int)p == selectedPoint)
+				markers.push_back({ pos.x, pos.y, pos.z, 1.0f, 1.0f, 1.0f });
+			else
+				markers.push_back({ pos.x, pos.y, pos.z, c.r, c.g, c.b });
+
+			if (p + 1 == points.size() || points[p + 1].plane != points[p].plane)
+				continue;
+
+			// split each segment per tile crossed so it follows the terrain
+			float nx = points[p + 1].x - regionBaseX + 0.5f;
+			float ny = points[p + 1].y - regionBaseY + 0.5f;
+			int steps = std::max(1, (int)std::max(std::fabs(nx - tx), std::fabs(ny - ty)) * 2);
+			glm::vec3 prev = pos;
+			for (int s = 1; s <= steps; ++s) {
+				float t = s / (float)steps;
+				glm::vec3 next = toScene(tx + (nx - tx) * t, ty + (ny - ty) * t);
+				lines.push_back({ prev.x, prev.y, prev.z, c.r, c.g, c.b });
+				lines.push_back({ next.x, next.y, next.z, c.r, c.g, c.b });
+				prev = next;
+			}
+		}
+	}
+
+	lineVertexCount = (int)lines.size();
+	markerCount = (int)markers.size();
+
+	long long staging = (long long)((lines.capacity() + markers.capacity()) * sizeof(PathVertex));
+	MemoryStats::add(MemoryCategory::MeshStaging, staging);
+
+	glBindBuffer(GL_ARRAY_BUFFER, lineVbo);
+	glBufferData(GL_ARRAY_BUFFER, lines.size() * sizeof(PathVertex), lines.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	glBufferData(GL_ARRAY_BUFFER, markers.size() * sizeof(PathVertex), markers.data(), GL_DYNAMIC_DRAW);
+	FrameProfiler::countUpload(lines.size() * sizeof(PathVertex));
+	FrameProfiler::countUpload(markers.size() * sizeof(PathVertex));
+	MemoryStats::add(MemoryCategory::MeshStaging, -staging);
+
+	// the cross VBO stays; the line and instance buffers were just replaced
+	long long uploaded = sizeof(float) * 18 + (long long)((lines.size() + markers.size()) * sizeof(PathVertex));
+	MemoryStats::add(MemoryCategory::GpuBuffers, uploaded - gpuBytes);
+	gpuBytes = uploaded;
+}
+
+void PathRenderer::render(const PathSet& paths, const glm::mat4& vp, int selectedPath, int selectedPoint) {
+	if (!program)
+		return;
+
+	if (paths.revision() != builtRevision || paths.getActiveIndex() != builtActive || MapRenderer::meshRevision != builtMeshRevision
+		|| selectedPath != builtSelectedPath || selectedPoint != builtSelectedPoint) {
+		rebuild(paths, selectedPath, selectedPoint);
+		builtRevision = paths.revision();
+		builtActive = paths.getActiveIndex();
+		builtSelectedPath = selectedPath;
+		builtSelectedPoint = selectedPoint;
+		builtMeshRevision = MapRenderer::meshRevision;
+	}
+
+	glUseProgram(program);
+	glUniformMatrix4fv(glGetUniformLocation(program, "uVP"), 1, GL_FALSE, glm::value_ptr(vp));
+
+	if (lineVertexCount > 0) {
+		glBindVertexArray(lineVao);
+		glVertexAttrib3f(2, 0.0f, 0.0f, 0.0f);
+		glDrawArrays(GL_LINES, 0, lineVertexCount);
+		FrameProfiler::countDraw(lineVertexCount);
+	}
+
+	if (markerCount > 0) {
+		glBindVertexArray(markerVao);
+		glDrawArraysInstanced(GL_LINES, 0, 6, markerCount);
+		FrameProfiler::countDraw(6 * markerCount);
+	}
+
+	glBindVertexArray(0);
+}
+
+void PathRenderer::cleanup() {
+	glDeleteProgram(program);
+	glDeleteBuffers(1, &lineVbo);
+	glDeleteBuffers(1, &markerVbo);
+	glDeleteBuffers(1, &instanceVbo);
+	glDeleteVertexArrays(1, &lineVao);
+	glDeleteVertexArrays(1, &markerVao);
+	MemoryStats::add(MemoryCategory::GpuBuffers, -gpuBytes);
+	gpuBytes = 0;
+	program = 0;
+}
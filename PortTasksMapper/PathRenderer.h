@@ -0,0 +1,37 @@
+#pragma once
+
+#ifndef PATHRENDERER_H
+#define PATHRENDERER_H
+
+#include <glm/glm.hpp>
+
+class PathSet;
+
+// Draws every saved path as terrain-draped lines plus an instanced marker per
+// point. All paths share one line buffer and one instance buffer, so the
+// whole set costs two draw calls; the buffers are only rebuilt when the
+// paths or the terrain mesh change.
+class PathRenderer {
+public:
+	void init();
+	void render(const PathSet& paths, const glm::mat4& vp, int selectedPath, int selectedPoint);
+	void cleanup();
+
+	int lineVertexCount = 0;
+	int markerCount = 0;
+
+private:
+	void rebuild(const PathSet& paths, int selectedPath, int selectedPoint);
+
+	unsigned int program = 0;
+	unsigned int lineVao = 0, lineVbo = 0;
+	unsigned int markerVao = 0, markerVbo = 0, instanceVbo = 0;
+	long long gpuBytes = 0;
+	unsigned int builtRevision = ~0u;
+	unsigned int builtMeshRevision = ~0u;
+	int builtActive = -1;
+	int builtSelectedPath = -1;
+	int builtSelectedPoint = -1;
+};
+
+#endif
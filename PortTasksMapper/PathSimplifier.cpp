@@ -0,0 +1,111 @@
+#include <cmath>
+#include <cstdlib>
+#include "PathSimplifier.h"
+
+namespace
+{
+	float distanceToSegment(const WorldPoint& p, const WorldPoint& a, const WorldPoint& b)
+	{
+		float dx = (float)(b.x - a.x);
+		float dy = (float)(b.y - a.y);
+		float len2 = dx * dx + dy * dy;
+		float t = len2 > 0.0f ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0.0f;
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		float ex = a.x + t * dx - p.x;
+		float ey = a.y + t * dy - p.y;
+		return std::sqrt(ex * ex + ey * ey);
+	}
+}
+
+bool PathSimplifier::lineOfSight(const WorldPoint& from, const WorldPoint& to, const TilePredicate& passable,
+	const StepPredicate& canStep)
+{
+	if (from.plane != to.plane)
+		return false;
+
+	// supercover walk: visits every tile the segment between tile centres
+	// touches, and both side tiles when it passes exactly through a corner
+	int x = from.x;
+	int y = from.y;
+	int nx = std::abs(to.x - from.x);
+	int ny = std::abs(to.y - from.y);
+	int sx = to.x > from.x ? 1 : -1;
+	int sy = to.y > from.y ? 1 : -1;
+
+	if (!passable(x, y, from.plane))
+		return false;
+
+	auto step = [&](int px, int py, int dx, int dy)
+	{
+		return !canStep || canStep(px, py, from.plane, dx, dy);
+	};
+
+	for (int ix = 0, iy = 0; ix < nx || iy < ny;)
+	{
+		int decision = (1 + 2 * ix) * ny - (1 + 2 * iy) * nx;
+		if (decision == 0)
+		{
+			if (!passable(x + sx, y, from.plane) || !passable(x, y + sy, from.plane))
+				return false;
+			// through a corner only if both ways around it are open
+			if (!step(x, y, sx, 0) || !step(x + sx, y, 0, sy) || !step(x, y, 0, sy) || !step(x, y + sy, sx, 0))
+				return false;
+			x += sx;
+			y += sy;
+			++ix;
+			++iy;
+		}
+		else if (decision < 0)
+		{
+			if (!step(x, y, sx, 0))
+				return false;
+			x += sx;
+			++ix;
+		}
+		else
+		{
+			if (!step(x, y, 0, sy))
+				return false;
+			y += sy;
+			++iy;
+		}
+		if (!passable(x, y, from.plane))
+			return false;
+	}
+	return true;
+}
+
+std::vector<WorldPoint> PathSimplifier::simplify(const std::vector<WorldPoint>& points, float tolerance, const TilePredicate& passable,
+	const StepPredicate& canStep)
+{
+	if (points.size() < 3)
+		return points;
+
+	std::vector<WorldPoint> result;
+	result.push_back(points[0]);
+
+	size_t anchor = 0;
+	while (anchor < points.size() - 1)
+	{
+		// greedily extend the segment from the anchor as far as it stays valid
+		size_t best = anchor + 1;
+		for (size_t end = anchor + 2; end < points.size(); ++end)
+		{
+			if (points[end].plane != points[anchor].plane)
+				break;
+			if (!lineOfSight(points[anchor], points[end], passable, canStep))
+				break;
+
+			bool covered = true;
+			for (size_t i = anchor + 1; i < end && covered; ++i)
+				covered = distanceToSegment(points[i], points[anchor], points[end]) <= tolerance;
+			if (!covered)
+				break;
+
+			best = end;
+		}
+		result.push_back(points[best]);
+		anchor = best;
+	}
+	return result;
+}
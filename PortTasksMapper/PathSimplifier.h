@@ -0,0 +1,26 @@
+#ifndef PATHSIMPLIFIER_H
+#define PATHSIMPLIFIER_H
+
+#include <functional>
+#include <vector>
+#include "WorldPoint.h"
+
+typedef std::function<bool(int x, int y, int plane)> TilePredicate;
+// whether a one-tile cardinal step from x, y by dx, dy is allowed (walls)
+typedef std::function<bool(int x, int y, int plane, int dx, int dy)> StepPredicate;
+
+// Reduces a tile path to the fewest waypoints the plugin still walks the
+// same way: every straight segment between kept points must cross only
+// passable tiles (and, with a step predicate, only allowed steps between
+// them), and every dropped point must lie within `tolerance` tiles of the
+// segment that replaces it.
+class PathSimplifier
+{
+public:
+	static std::vector<WorldPoint> simplify(const std::vector<WorldPoint>& points, float tolerance, const TilePredicate& passable,
+		const StepPredicate& canStep = nullptr);
+	static bool lineOfSight(const WorldPoint& from, const WorldPoint& to, const TilePredicate& passable,
+		const StepPredicate& canStep = nullptr);
+};
+
+#endif // PATHSIMPLIFIER_H
@@ -0,0 +1,237 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+#include "PngWriter.h"
+
+namespace
+{
+	struct CrcTable
+	{
+		unsigned int entries[256];
+
+		constexpr CrcTable() : entries()
+		{
+			for (unsigned int n = 0; n < 256; ++n)
+			{
+				unsigned int c = n;
+				for (int k = 0; k < 8; ++k)
+					c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				entries[n] = c;
+			}
+		}
+	};
+
+	// built at compile time, so the tile writers never race to fill it
+	constexpr CrcTable crcTable;
+
+	unsigned int crc32(const unsigned char* data, size_t len, unsigned int crc = 0xFFFFFFFFu)
+	{
+		for (size_t i = 0; i < len; ++i)
+			crc = crcTable.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return crc;
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<unsigned char>& out) : out(out) {}
+
+		void bits(unsigned int value, int count)
+		{
+			buffer |= value << used;
+			used += count;
+			while (used >= 8)
+			{
+				out.push_back((unsigned char)buffer);
+				buffer >>= 8;
+				used -= 8;
+			}
+		}
+
+		// Huffman codes are stored most significant bit first
+		void code(unsigned int value, int count)
+		{
+			unsigned int reversed = 0;
+			for (int i = 0; i < count; ++i)
+				reversed |= ((value >> i) & 1) << (count - 1 - i);
+			bits(reversed, count);
+		}
+
+		void flush()
+		{
+			if (used > 0)
+				out.push_back((unsigned char)buffer);
+			buffer = 0;
+			used = 0;
+		}
+
+	private:
+		std::vector<unsigned char>& out;
+		unsigned int buffer = 0;
+		int used = 0;
+	};
+
+	const unsigned short lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned char lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned short distBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned char distExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	void writeSymbol(BitWriter& w, int symbol)
+	{
+		if (symbol < 144)
+			w.code(0x30 + symbol, 8);
+		else if (symbol < 256)
+			w.code(0x190 + symbol - 144, 9);
+		else if (symbol < 280)
+			w.code(symbol - 256, 7);
+		else
+			w.code(0xC0 + symbol - 280, 8);
+	}
+
+	void writeMatch(BitWriter& w, int length, int distance)
+	{
+		int l = 28;
+		while (lengthBase[l] > length)
+			--l;
+		writeSymbol(w, 257 + l);
+		w.bits(length - lengthBase[l], lengthExtra[l]);
+
+		int d = 29;
+		while (distBase[d] > distance)
+			--d;
+		w.code(d, 5);
+		w.bits(distance - distBase[d], distExtra[d]);
+	}
+
+	void deflate(const unsigned char* data, size_t len, std::vector<unsigned char>& out)
+	{
+		const int WINDOW = 32768;
+		const int HASH_BITS = 15;
+		std::vector<int> head(1 << HASH_BITS, -1);
+
+		out.push_back(0x78);
+		out.push_back(0x01);
+
+		BitWriter w(out);
+		w.bits(1, 1); // final block
+		w.bits(1, 2); // fixed Huffman
+
+		size_t i = 0;
+		while (i < len)
+		{
+			int bestLength = 0;
+			int bestDistance = 0;
+			if (i + 3 <= len)
+			{
+				unsigned int h = ((data[i] << 16) | (data[i + 1] << 8) | data[i + 2]) * 2654435761u >> (32 - HASH_BITS);
+				int candidate = head[h];
+				head[h] = (int)i;
+
+				// the previous byte and pixel are always good guesses for filtered rows
+				const int tries[3] = { candidate, (int)i - 1, (int)i - 3 };
+				for (int t = 0; t < 3; ++t)
+				{
+					int c = tries[t];
+					if (c < 0 || (int)i - c > WINDOW || c >= (int)i)
+						continue;
+					int length = 0;
+					while (length < 258 && i + length < len && data[c + length] == data[i + length])
+						++length;
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = (int)i - c;
+					}
+				}
+			}
+
+			if (bestLength >= 3)
+			{
+				writeMatch(w, bestLength, bestDistance);
+				i += bestLength;
+			}
+			else
+			{
+				writeSymbol(w, data[i]);
+				++i;
+			}
+		}
+		writeSymbol(w, 256);
+		w.flush();
+
+		unsigned int a = 1, b = 0;
+		for (size_t k = 0; k < len; ++k)
+		{
+			a = (a + data[k]) % 65521;
+			b = (b + a) % 65521;
+		}
+		unsigned int adler = b << 16 | a;
+		for (int shift = 24; shift >= 0; shift -= 8)
+			out.push_back((unsigned char)(adler >> shift));
+	}
+
+	void putU32(std::vector<unsigned char>& out, unsigned int v)
+	{
+		for (int shift = 24; shift >= 0; shift -= 8)
+			out.push_back((unsigned char)(v >> shift));
+	}
+
+	void writeChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+	{
+		putU32(out, (unsigned int)data.size());
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		putU32(out, crc32(&out[start], out.size() - start) ^ 0xFFFFFFFFu);
+	}
+}
+
+bool encodePng(const unsigned char* rgb, int width, int height, std::vector<unsigned char>& out)
+{
+	if (width <= 0 || height <= 0)
+		return false;
+
+	const size_t stride = (size_t)width * 3;
+	std::vector<unsigned char> filtered((stride + 1) * height);
+	for (int y = 0; y < height; ++y)
+	{
+		const unsigned char* row = rgb + y * stride;
+		unsigned char* dst = &filtered[y * (stride + 1)];
+		dst[0] = 1; // Sub
+		for (size_t x = 0; x < stride; ++x)
+			dst[1 + x] = (unsigned char)(row[x] - (x >= 3 ? row[x - 3] : 0));
+	}
+
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	out.assign(signature, signature + 8);
+
+	std::vector<unsigned char> header;
+	putU32(header, (unsigned int)width);
+	putU32(header, (unsigned int)height);
+	header.push_back(8); // bit depth
+	header.push_back(2); // RGB
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+	writeChunk(out, "IHDR", header);
+
+	std::vector<unsigned char> compressed;
+	deflate(filtered.data(), filtered.size(), compressed);
+	writeChunk(out, "IDAT", compressed);
+	writeChunk(out, "IEND", {});
+	return true;
+}
+
+bool writePng(const char* filename, const unsigned char* rgb, int width, int height)
+{
+	std::vector<unsigned char> png;
+	if (!encodePng(rgb, width, height, png))
+		return false;
+
+	FILE* file = fopen(filename, "wb");
+	if (!file) return false;
+
+	bool ok = fwrite(png.data(), 1, png.size(), file) == png.size();
+	return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,12 @@
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <vector>
+
+// Minimal RGB8 PNG encoder: Sub-filtered scanlines compressed with a small
+// LZ77 + fixed-Huffman deflate. Map tiles are mostly flat colour, which
+// this handles well without pulling in zlib.
+bool encodePng(const unsigned char* rgb, int width, int height, std::vector<unsigned char>& out);
+bool writePng(const char* filename, const unsigned char* rgb, int width, int height);
+
+#endif // PNGWRITER_H
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstdlib>
+#include "PointIndex.h"
+
+namespace
+{
+	int cellCoord(int v)
+	{
+		return v >= 0 ? v / PointIndex::CELL_SIZE : (v - PointIndex::CELL_SIZE + 1) / PointIndex::CELL_SIZE;
+	}
+}
+
+long long PointIndex::cellKey(int x, int y, int plane)
+{
+	return (long long)(plane & 0x3) << 60 | (long long)(cellCoord(x) & 0x3FFFFFFF) << 30 | (cellCoord(y) & 0x3FFFFFFF);
+}
+
+void PointIndex::insert(const WorldPoint& point, const PointKey& key)
+{
+	cells[cellKey(point.x, point.y, point.plane)].push_back({ point, key });
+}
+
+void PointIndex::erase(const WorldPoint& point, const PointKey& key)
+{
+	auto it = cells.find(cellKey(point.x, point.y, point.plane));
+	if (it == cells.end())
+		return;
+
+	std::vector<Entry>& entries = it->second;
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (entries[i].key.path == key.path && entries[i].key.point == key.point)
+		{
+			entries[i] = entries.back();
+			entries.pop_back();
+			break;
+		}
+	}
+	if (entries.empty())
+		cells.erase(it);
+}
+
+void PointIndex::move(const WorldPoint& from, const WorldPoint& to, const PointKey& key)
+{
+	erase(from, key);
+	insert(to, key);
+}
+
+void PointIndex::clear()
+{
+	cells.clear();
+}
+
+size_t PointIndex::memoryBytes() const
+{
+	size_t bytes = cells.bucket_count() * sizeof(void*);
+	for (const auto& cell : cells)
+		bytes += sizeof(cell) + cell.second.capacity() * sizeof(Entry);
+	return bytes;
+}
+
+template <typename Visit>
+void PointIndex::forEachInRange(int x, int y, int plane, int radius, Visit visit) const
+{
+	for (int cx = cellCoord(x - radius); cx <= cellCoord(x + radius); ++cx)
+	{
+		for (int cy = cellCoord(y - radius); cy <= cellCoord(y + radius); ++cy)
+		{
+			auto it = cells.find(cellKey(cx * CELL_SIZE, cy * CELL_SIZE, plane));
+			if (it == cells.end())
+				continue;
+
+			for (const Entry& entry : it->second)
+			{
+				if (entry.point.plane == plane && std::abs(entry.point.x - x) <= radius && std::abs(entry.point.y - y) <= radius)
+					visit(entry);
+			}
+		}
+	}
+}
+
+void PointIndex::query(int x, int y, int plane, int radius, std::vector<PointKey>& out) const
+{
+	forEachInRange(x, y, plane, radius, [&](const Entry& entry)
+	{
+		out.push_back(entry.key);
+	});
+}
+
+bool PointIndex::nearest(int x, int y, int plane, int radius, PointKey& out) const
+{
+	bool found = false;
+	int bestDist = 0;
+	forEachInRange(x, y, plane, radius, [&](const Entry& entry)
+	{
+		int dx = entry.point.x - x;
+		int dy = entry.point.y - y;
+		int dist = dx * dx + dy * dy;
+		if (!found || dist < bestDist)
+		{
+			found = true;
+			bestDist = dist;
+			out = entry.key;
+		}
+	});
+	return found;
+}
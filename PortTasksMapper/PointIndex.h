@@ -0,0 +1,55 @@
+#ifndef POINTINDEX_H
+#define POINTINDEX_H
+
+#include <unordered_map>
+#include <vector>
+#include "WorldPoint.h"
+
+struct PointRef
+{
+	int path;
+	int index;
+};
+
+// Stable ids of a path and of a point within it; unlike PointRef they do not
+// shift when points or paths before them are inserted or removed.
+struct PointKey
+{
+	unsigned int path;
+	unsigned int point;
+};
+
+// Uniform grid over path points, bucketed by CELL_SIZE x CELL_SIZE tiles per
+// plane. PathSet keeps it in sync on every edit, so lookups never scan the
+// full point list. Entries are keyed by PointKey, so an edit touches only
+// the entry of the point it changes; PathSet resolves keys to positions.
+class PointIndex
+{
+public:
+	static const int CELL_SIZE = 8;
+
+	void insert(const WorldPoint& point, const PointKey& key);
+	void erase(const WorldPoint& point, const PointKey& key);
+	void move(const WorldPoint& from, const WorldPoint& to, const PointKey& key);
+	void clear();
+	size_t memoryBytes() const;
+
+	// every point within `radius` tiles (Chebyshev) of x, y on the plane
+	void query(int x, int y, int plane, int radius, std::vector<PointKey>& out) const;
+	bool nearest(int x, int y, int plane, int radius, PointKey& out) const;
+
+private:
+	struct Entry
+	{
+		WorldPoint point;
+		PointKey key;
+	};
+
+	static long long cellKey(int x, int y, int plane);
+	template <typename Visit>
+	void forEachInRange(int x, int y, int plane, int radius, Visit visit) const;
+
+	std::unordered_map<long long, std::vector<Entry>> cells;
+};
+
+#endif // POINTINDEX_H
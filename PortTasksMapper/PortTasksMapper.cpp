@@ -1,5 +1,6 @@
 #define GLFW_INCLUDE_NONE
 #include <iostream>
+#include <algorithm>
 #include <windows.h>
 #include "pch.h"
 
@@ -16,9 +17,41 @@
 #include "MapLoader.h"
 #include "MapRenderer.h"
 #include "Utils.h"
+#include "WorldMap.h"
+#include "SeaRouter.h"
+#include "PathSimplifier.h"
+#include "Path.h"
+#include "PathExporter.h"
+#include "RouteValidator.h"
+#include "EditHistory.h"
+#include "RouteMatrix.h"
+#include "MapTiler.h"
+#include "Benchmark.h"
+#include "WorldComponents.h"
+#include "FrameProfiler.h"
+#include "Trace.h"
+#include "MemoryStats.h"
+#include "Underlay.h"
+#include "RegionStreamer.h"
+#include "GpuUploader.h"
+#include "CollisionMap.h"
+#include "RegionCache.h"
+#include "JobSystem.h"
 
 void hideConsole();
 void drawUI();
+void simplifySavedPoints();
+void updateMemoryStats();
+void buildPortRoutes();
+void collectPortRoutes();
+bool routesBuilding();
+void streamRegions(RegionStreamer& streamer, GpuUploader& uploader, MapRenderer& renderer);
+void evictRegions(RegionStreamer& streamer, GpuUploader& uploader);
+void refreshRouting();
+void relabelComponents();
+bool componentColor(int x, int y, glm::vec3& color);
+bool overlayColor(int x, int y, glm::vec3& color);
+void updateTileOverlay();
 
 extern float yaw;
 extern float pitch;
@@ -28,11 +61,90 @@ extern glm::vec3 cameraPos;
 extern int guiHoverTileX;
 extern int guiHoverTileY;
 extern Tile*** guitiles;
-extern std::vector<std::string> savedPoints;
 static bool showWireframe = true;
 
-int main() {
-	
+WorldMap world;
+SeaRouter seaRouter(world);
+EditHistory editHistory(savedPaths, world);
+RouteMatrix portRoutes(world, seaRouter);
+WorldComponents components;
+CollisionMap collision;
+RegionCache regionCache(256u << 20, 256u << 20);
+static bool showComponents = false;
+static bool showCollision = false;
+static WorldPoint routeStart = { -1, -1, 0 };
+static int routeClearance = 2;
+static float simplifyTolerance = 1.0f;
+// streamed regions not yet in the sea router or component labels
+static std::vector<std::pair<int, int>> pendingRouting;
+// component labels are out of date (regions removed or tiles edited)
+static bool componentsDirty = false;
+// a port route build running on the job pool; until it finishes the world,
+// sea router, components and port list it reads are left untouched
+static std::unique_ptr<Job> routeBuild;
+// vertex bytes sent to the GPU per frame while regions stream in
+static const size_t UPLOAD_BUDGET = 256 * 1024;
+
+// headless commands run before any window or GL context exists; -1 if argv names none
+int runHeadless(int argc, char** argv) {
+	if (argc > 1 && !strcmp(argv[1], "--validate"))
+		return RouteValidator::runCommand(argc, argv);
+	if (argc > 1 && !strcmp(argv[1], "--routes"))
+		return RouteMatrix::runCommand(argc, argv);
+	if (argc > 1 && !strcmp(argv[1], "--tiles"))
+		return MapTiler::runCommand(argc, argv);
+	if (argc > 1 && !strcmp(argv[1], "--bench"))
+		return Benchmark::runCommand(argc, argv);
+	return -1;
+}
+
+int main(int argc, char** argv) {
+	Trace::setThreadName("main");
+
+	// --trace <file> records the whole headless command
+	const char* traceFile = nullptr;
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (!strcmp(argv[i], "--trace")) {
+			traceFile = argv[i + 1];
+			for (int j = i; j + 2 <= argc; ++j)
+				argv[j] = argv[j + 2];
+			argc -= 2;
+			Trace::start();
+			break;
+		}
+	}
+	int status = runHeadless(argc, argv);
+	if (status >= 0) {
+		if (traceFile && !Trace::dump(traceFile))
+			std::cerr << "Failed to write " << traceFile << "\n";
+		return status;
+	}
+
+	// --continuous redraws every frame instead of only when something changed
+	// --upload-thread fills region buffers from a second, shared GL context
+	// --keys names the XTEA key file for l files (default <maps>/keys.txt)
+	// --cpu-budget / --gpu-budget cap resident regions, in MB (default 256 each)
+	bool continuous = false;
+	bool uploadThread = false;
+	const char* mapDir = ".";
+	const char* keyFile = nullptr;
+	int cpuBudgetMb = 256;
+	int gpuBudgetMb = 256;
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--continuous"))
+			continuous = true;
+		else if (!strcmp(argv[i], "--upload-thread"))
+			uploadThread = true;
+		else if (!strcmp(argv[i], "--maps") && i + 1 < argc)
+			mapDir = argv[++i];
+		else if (!strcmp(argv[i], "--keys") && i + 1 < argc)
+			keyFile = argv[++i];
+		else if (!strcmp(argv[i], "--cpu-budget") && i + 1 < argc)
+			cpuBudgetMb = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--gpu-budget") && i + 1 < argc)
+			gpuBudgetMb = std::max(1, atoi(argv[++i]));
+	}
+	regionCache.setBudgets((size_t)cpuBudgetMb << 20, (size_t)gpuBudgetMb << 20);
 
 	if (!glfwInit()) {
 		std::cerr << "Failed to init GLFW\n";
@@ -59,26 +171,53 @@ int main() {
 		return -1;
 	}
 
+	renderer.initMap();
+	FrameProfiler::init();
+
 	glfwSetCursorPosCallback(window, MapRenderer::mouse_callback);
 	glfwSetMouseButtonCallback(window, MapRenderer::mouse_button_callback);
 	glfwSetScrollCallback(window, MapRenderer::scroll_callback);
+	// ImGui chains to these, so typing into the UI also wakes the loop
+	glfwSetKeyCallback(window, [](GLFWwindow*, int, int, int, int) { MapRenderer::requestRedraw(); });
+	glfwSetCharCallback(window, [](GLFWwindow*, unsigned int) { MapRenderer::requestRedraw(); });
+	glfwSetWindowFocusCallback(window, [](GLFWwindow*, int) { MapRenderer::requestRedraw(); });
+	glfwSetCursorEnterCallback(window, [](GLFWwindow*, int) { MapRenderer::requestRedraw(); });
+	glfwSetWindowRefreshCallback(window, [](GLFWwindow*) { MapRenderer::requestRedraw(); });
 
 
-	size_t bufSize;
-	unsigned char* buf = loadFileBytes("m50_50.dat", &bufSize);
-	if (buf)
+	portRoutes.setComponents(&components);
+	editHistory.onTileChanged = [](int x, int y, int)
 	{
-		Tile*** tiles = MapLoader::loadTerrain(buf, bufSize);
-		renderer.uploadTileMesh(tiles);
-		renderer.setTiles(tiles);
-		free(buf);
-	}
-	else
-	{
-		std::cerr << "Failed to load map data\n";
-	}
-
-
+		int regionX = x / WorldMap::REGION_SIZE;
+		int regionY = y / WorldMap::REGION_SIZE;
+		seaRouter.addRegion(regionX, regionY);
+		// only this region is rescanned, and only once labels are next needed
+		components.invalidate(regionX, regionY);
+		componentsDirty = true;
+		collision.buildRegion(world, regionX, regionY);
+		// edits live only in the loaded tiles, so the region must not be evicted
+		regionCache.pin(regionX, regionY);
+		// the overlay shows labels, so it relabels (and recolours) right away
+		if (showComponents)
+			relabelComponents();
+		else
+			MapRenderer::uploadTileMesh(regionX, regionY, world.getRegion(regionX, regionY));
+	};
+
+	// regions are decoded and meshed on workers, the home region included,
+	// so the first frame never waits on disk
+	XteaKeyStore keys;
+	std::string defaultKeyFile = std::string(mapDir) + "/keys.txt";
+	if (!keys.load(keyFile ? keyFile : defaultKeyFile.c_str()) && keyFile)
+		std::cerr << "Failed to read XTEA keys from " << keyFile << "\n";
+	RegionStreamer streamer(mapDir, 2, []() { MapRenderer::requestRedraw(); }, &keys);
+	GpuUploader uploader;
+	if (uploadThread && !uploader.start(window))
+		std::cerr << "Failed to create upload context, uploading on the render thread\n";
+	streamer.request(MapRenderer::HOME_REGION_X, MapRenderer::HOME_REGION_Y);
+
+	MemoryStats::add(MemoryCategory::ColorTables, (long long)colorTableBytes());
+	MemoryStats::trackImGuiAllocations();
 	ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO(); (void)io;
 	ImGui::StyleColorsDark();
@@ -87,27 +226,70 @@ int main() {
 	ImGui_ImplOpenGL3_Init("#version 330");
 
 	while (!glfwWindowShouldClose(window)) {
+		if (!continuous && !FrameProfiler::enabled && !MapRenderer::takeRedraw()) {
+			// nothing on screen would change; sleep until input or requestRedraw
+			glfwWaitEvents();
+			continue;
+		}
+
+		TRACE_SCOPE("frame", "frame");
+		FrameProfiler::beginFrame();
+		streamRegions(streamer, uploader, renderer);
+		evictRegions(streamer, uploader);
+		collectPortRoutes();
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 		
 		renderer.renderMap();
 
+		FrameProfiler::beginStage(FrameStage::UiBuild);
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
 
-		drawUI();
+		{
+			TRACE_SCOPE("drawUI", "ui");
+			drawUI();
+			FrameProfiler::drawPanel();
+			updateMemoryStats();
+			MemoryStats::drawPanel();
+		}
 
 		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		FrameProfiler::endStage(FrameStage::UiBuild);
 
+		FrameProfiler::beginStage(FrameStage::UiRender);
+		ImDrawData* drawData = ImGui::GetDrawData();
+		for (int i = 0; i < drawData->CmdListsCount; ++i)
+			for (const ImDrawCmd& cmd : drawData->CmdLists[i]->CmdBuffer)
+				FrameProfiler::countDraw(cmd.ElemCount);
+		ImGui_ImplOpenGL3_RenderDrawData(drawData);
+		FrameProfiler::endStage(FrameStage::UiRender);
+
+		FrameProfiler::beginStage(FrameStage::Swap);
 		glfwSwapBuffers(window);
+		FrameProfiler::endStage(FrameStage::Swap);
+
+		FrameProfiler::beginStage(FrameStage::Input);
 		glfwPollEvents();
+		FrameProfiler::endStage(FrameStage::Input);
+		FrameProfiler::endFrame();
+
+		// widgets being dragged or typed into and camera drags keep animating
+		if (ImGui::IsAnyItemActive() || ImGui::GetIO().WantTextInput || MapRenderer::isInteracting())
+			MapRenderer::requestRedraw();
 	}
 
+	if (routeBuild)
+		JobSystem::wait(*routeBuild);
+	// loads still in flight would call requestRedraw after glfwTerminate
+	streamer.stop();
+	// GL objects go while their context still exists
+	uploader.stop();
+	FrameProfiler::cleanup();
+	renderer.cleanupMap();
 	glfwDestroyWindow(window);
 	glfwTerminate();
-	renderer.cleanupMap();
 	return 0;
 }
 
@@ -121,7 +303,7 @@ void hideConsole() {
 void drawUI()
 {
 	ImGui::SetNextWindowBgAlpha(0.5f);
-	ImGui::SetNextWindowSize(ImVec2(280, 160));
+	ImGui::SetNextWindowSize(ImVec2(280, 378));
 	ImGui::Begin("Port Tasks", nullptr,
 		ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize |
 		ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse);
@@ -131,8 +313,40 @@ void drawUI()
 	{
 		std::cout << "Button was clicked!\n";
 	}
+	ImGui::Checkbox("Profiler", &FrameProfiler::enabled);
+	ImGui::SameLine();
+	ImGui::Checkbox("Memory", &MemoryStats::panelOpen);
+	ImGui::SameLine();
+	bool tracing = Trace::isRecording();
+	if (ImGui::Checkbox("Trace", &tracing))
+	{
+		// switching tracing off writes everything recorded since it was switched on
+		if (tracing)
+		{
+			Trace::start();
+		}
+		else
+		{
+			Trace::stop();
+			if (Trace::dump("trace.json"))
+				std::cout << "Wrote trace.json\n";
+			else
+				std::cerr << "Failed to write trace.json\n";
+		}
+	}
 	if (ImGui::Checkbox("Wireframe", &showWireframe))
 		glPolygonMode(GL_FRONT_AND_BACK, showWireframe ? GL_LINE : GL_FILL);
+	ImGui::SameLine();
+	if (ImGui::Checkbox("Components", &showComponents))
+	{
+		refreshRouting();
+		updateTileOverlay();
+	}
+	if (ImGui::Checkbox("Objects", &MapRenderer::showObjects))
+		MapRenderer::requestRedraw();
+	ImGui::SameLine();
+	if (ImGui::Checkbox("Collision", &showCollision))
+		updateTileOverlay();
 
 	ImGui::Spacing();
 	ImGui::Separator();
@@ -147,9 +361,75 @@ void drawUI()
 	if (ImGui::SliderFloat("Distance", &distance, 60.0f, 300.0f, "%.0f"))
 		distance = roundf(distance);
 
+	ImGui::Spacing();
+	ImGui::Separator();
+	ImGui::Spacing();
+
+	const bool hovering = guiHoverTileX >= 0 && guiHoverTileY >= 0;
+	const WorldPoint hovered = { 50 * 64 + guiHoverTileX, 50 * 64 + guiHoverTileY, 0 };
+
+	// keyboard driven so the hovered tile is the one under the cursor, not under a button
+	const bool keysFree = !ImGui::GetIO().WantCaptureKeyboard;
+	// tile edits and new ports wait for a running route build
+	const bool building = routesBuilding();
+
+	ImGui::SliderInt("Clearance", &routeClearance, 0, 8);
+	ImGui::Text("Sea route: [S] start  [R] route here");
+	if (keysFree && hovering && ImGui::IsKeyPressed(ImGuiKey_S, false))
+		routeStart = hovered;
+	if (keysFree && hovering && routeStart.x >= 0 && ImGui::IsKeyPressed(ImGuiKey_R, false))
+	{
+		refreshRouting();
+		std::vector<WorldPoint> route = seaRouter.findRoute(routeStart, hovered, routeClearance);
+		if (route.empty())
+		{
+			std::cerr << "No sea route found\n";
+		}
+		else
+		{
+			editHistory.addPath("Route " + std::to_string(savedPaths.paths().size() + 1), route);
+		}
+	}
+	if (routeStart.x >= 0)
+		ImGui::Text("Start: %d, %d", routeStart.x, routeStart.y);
+
+	ImGui::SliderFloat("Tolerance", &simplifyTolerance, 0.0f, 4.0f, "%.1f");
+	if (ImGui::Button("Simplify Points"))
+		simplifySavedPoints();
+
+	ImGui::SameLine();
+	ImGui::BeginDisabled(!editHistory.canUndo() || building);
+	if (ImGui::Button("Undo") || (keysFree && !building && ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiKey_Z)))
+		editHistory.undo();
+	ImGui::EndDisabled();
+	ImGui::SameLine();
+	ImGui::BeginDisabled(!editHistory.canRedo() || building);
+	if (ImGui::Button("Redo") || (keysFree && !building && ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiKey_Y)))
+		editHistory.redo();
+	ImGui::EndDisabled();
+
+	if (keysFree && MapRenderer::hasSelection() && ImGui::IsKeyPressed(ImGuiKey_Delete, false))
+	{
+		editHistory.erasePoint(MapRenderer::selectedPath, MapRenderer::selectedPoint);
+		MapRenderer::clearSelection();
+	}
+
+	ImGui::Text("[P] add port (%d)", (int)portRoutes.getPorts().size());
+	if (keysFree && !building && hovering && ImGui::IsKeyPressed(ImGuiKey_P, false))
+		portRoutes.addPort("Port" + std::to_string(portRoutes.getPorts().size() + 1), hovered);
+	ImGui::SameLine();
+	ImGui::BeginDisabled(building);
+	if (ImGui::Button(building ? "Building..." : "Build Routes"))
+		buildPortRoutes();
+	ImGui::EndDisabled();
+
+	ImGui::Text("[W] toggle water  [Del] delete point");
+	if (keysFree && !building && hovering && ImGui::IsKeyPressed(ImGuiKey_W, false))
+		editHistory.setTileField(hovered.x, hovered.y, 0, TileField::OverlayId, world.isWater(hovered.x, hovered.y) ? 0 : 6);
+
 	ImGui::End();
 
-	ImVec2 window_size(220, 110);
+	ImVec2 window_size(220, 130);
 	ImVec2 window_pos(800 - window_size.x - 10, 10);
 
 	ImGui::SetNextWindowPos(window_pos, ImGuiCond_Always);
@@ -170,10 +450,14 @@ void drawUI()
 		const int worldY = regionY * 64 + guiHoverTileY;
 
 		ImGui::Text("Tile Info:");
-		ImGui::Text("Map X: %d   Y: %d", guiHoverTileX, guiHoverTileY);
+		ImGui::Text("Map X: %d   Y: %d%s", guiHoverTileX, guiHoverTileY, collision.isBlocked(worldX, worldY, 0) ? "   (blocked)" : "");
 		ImGui::Text("World X: %d   Y: %d", worldX, worldY);
 		ImGui::Text("Overlay ID: %d", tile.overlayId);
 		ImGui::Text("Underlay ID: %d", tile.underlayId);
+
+		int component = components.componentAt(worldX, worldY);
+		if (component >= 0)
+			ImGui::Text("%s #%d (%d tiles)", components.isWater(component) ? "Water body" : "Landmass", component, components.size(component));
 	}
 	else
 	{
@@ -186,7 +470,7 @@ void drawUI()
 	GLFWwindow* window = glfwGetCurrentContext();
 	glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
 
-	ImVec2 bl_window_size(177, 185);
+	ImVec2 bl_window_size(200, 220);
 	ImVec2 bl_window_pos(2, windowHeight - bl_window_size.y - 2);
 
 	ImGui::SetNextWindowPos(bl_window_pos, ImGuiCond_Always);
@@ -197,24 +481,313 @@ void drawUI()
 		ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse |
 		ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoTitleBar);
 
-	static std::vector<char> buffer(1024 * 10, 0); 
+	const std::vector<Path>& paths = savedPaths.paths();
+	const Path& active = savedPaths.active();
+
+	ImGui::SetNextItemWidth(100);
+	if (ImGui::BeginCombo("##path", active.name.c_str()))
+	{
+		for (int i = 0; i < (int)paths.size(); ++i)
+		{
+			ImGui::PushID(i);
+			if (ImGui::Selectable(paths[i].name.c_str(), i == savedPaths.getActiveIndex()))
+				savedPaths.setActive(i);
+			ImGui::PopID();
+		}
+		ImGui::EndCombo();
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("New"))
+		editHistory.addPath("Path " + std::to_string(paths.size() + 1), {});
+
+	const std::vector<WorldPoint>& points = savedPaths.active().points;
+	if (ImGui::Button("Copy"))
+		ImGui::SetClipboardText(formatPath(savedPaths.active()).c_str());
+	ImGui::SameLine();
+	if (ImGui::Button("Export"))
+	{
+		double start = glfwGetTime();
+		if (PathExporter::writeAll(savedPaths.paths(), "paths"))
+			std::cout << "Exported " << paths.size() << " paths in " << (glfwGetTime() - start) * 1000.0 << " ms\n";
+		else
+			std::cerr << "Failed to export paths\n";
+	}
+	ImGui::SameLine();
+	ImGui::Text("%d pts", (int)points.size());
+
+	// only the rows that are scrolled into view get formatted
+	ImGui::BeginChild("##savedPoints", ImVec2(0, 0), ImGuiChildFlags_Borders);
+	ImGuiListClipper clipper;
+	clipper.Begin((int)points.size());
+	while (clipper.Step())
+	{
+		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+		{
+			char buf[64];
+			formatWorldPoint(points[i], buf, sizeof(buf));
+			ImGui::PushID(i);
+			bool selected = MapRenderer::selectedPath == savedPaths.getActiveIndex() && MapRenderer::selectedPoint == i;
+			if (ImGui::Selectable(buf, selected))
+			{
+				MapRenderer::selectedPath = savedPaths.getActiveIndex();
+				MapRenderer::selectedPoint = i;
+			}
+			ImGui::PopID();
+		}
+	}
+	clipper.End();
+	ImGui::EndChild();
+
+	ImGui::End();
+}
+
+// sizes of structures that are measured rather than tracked allocation by allocation
+void updateMemoryStats()
+{
+	MemoryStats::set(MemoryCategory::Paths, (long long)(savedPaths.memoryBytes() + editHistory.memoryBytes()));
+	MemoryStats::set(MemoryCategory::Routing, (long long)(seaRouter.memoryBytes() + components.memoryBytes() + collision.memoryBytes()));
+
+	// region impostors, plus ImGui textures which the GL3 backend keeps as RGBA8
+	long long textureBytes = (long long)MapRenderer::impostorBytes();
+	for (const ImTextureData* texture : ImGui::GetPlatformIO().Textures)
+		if (texture->Status != ImTextureStatus_Destroyed && texture->TexID != ImTextureID_Invalid)
+			textureBytes += (long long)texture->Width * texture->Height * 4;
+	MemoryStats::set(MemoryCategory::GpuTextures, textureBytes);
+}
+
+void simplifySavedPoints()
+{
+	const std::vector<WorldPoint>& points = savedPaths.active().points;
+
+	// a path made only of water is a sea route and stays on water,
+	// anything else must keep to walkable tiles
+	bool seaRoute = true;
+	for (const WorldPoint& p : points)
+		seaRoute = seaRoute && world.isWater(p.x, p.y);
+
+	std::vector<WorldPoint> simplified = PathSimplifier::simplify(points, simplifyTolerance,
+		[seaRoute](int x, int y, int plane)
+		{
+			return seaRoute ? world.isWater(x, y) : collision.isWalkable(x, y, plane);
+		},
+		[seaRoute](int x, int y, int plane, int dx, int dy)
+		{
+			return seaRoute || collision.canStep(x, y, plane, dx, dy);
+		});
+
+	editHistory.replacePoints(savedPaths.getActiveIndex(), simplified);
+}
+
+bool routesBuilding()
+{
+	return routeBuild && !JobSystem::isDone(*routeBuild);
+}
+
+// runs the build on the job pool so a large port list never stalls frames;
+// collectPortRoutes picks up the result
+void buildPortRoutes()
+{
+	if (routeBuild)
+		return;
+
+	refreshRouting();
+	int clearance = routeClearance;
+	routeBuild.reset(new Job());
+	routeBuild->work = [clearance]()
+	{
+		portRoutes.loadCache("routes.cache");
+		portRoutes.build(clearance, defaultThreadCount());
+		if (!portRoutes.saveCache("routes.cache"))
+			std::cerr << "Failed to write routes.cache\n";
+		MapRenderer::requestRedraw();
+	};
+	JobSystem::run(*routeBuild);
+}
+
+// adds each finished route as a path, replacing the one of the same name
+// from an earlier build rather than adding a duplicate
+void collectPortRoutes()
+{
+	if (!routeBuild || !JobSystem::isDone(*routeBuild))
+		return;
+	routeBuild.reset();
+
+	for (const Path& path : portRoutes.toPaths())
+	{
+		const std::vector<Path>& existing = savedPaths.paths();
+		auto same = std::find_if(existing.begin(), existing.end(), [&path](const Path& p) { return p.name == path.name; });
+		if (same == existing.end())
+			editHistory.addPath(path.name, path.points);
+		else if (same->points != path.points)
+			editHistory.replacePoints((int)(same - existing.begin()), path.points);
+	}
+	std::cout << portRoutes.getRoutes().size() << " port routes, " << portRoutes.getCachedCount() << " from cache\n";
+}
 
-	std::string allPoints;
-	for (const auto& p : savedPoints)
-		allPoints += p + "\n";
+void streamRegions(RegionStreamer& streamer, GpuUploader& uploader, MapRenderer& renderer)
+{
+	std::unique_ptr<StreamedRegion> region;
+	bool homeArrived = false;
+	// finished regions stay queued while a route build reads the world
+	while (!routesBuilding() && streamer.poll(region))
+	{
+		if (!region->tiles)
+			continue;
+
+		int regionX = region->regionX;
+		int regionY = region->regionY;
+		world.addRegion(regionX, regionY, region->tiles);
+		regionCache.add(regionX, regionY);
+		pendingRouting.push_back({ regionX, regionY });
+		if (regionX == MapRenderer::HOME_REGION_X && regionY == MapRenderer::HOME_REGION_Y)
+		{
+			// the home region is picked and edited through its tile pointer
+			regionCache.pin(regionX, regionY);
+			renderer.setTiles(region->tiles);
+			MapRenderer::setHomeHeights(region->heights);
+			homeArrived = true;
+		}
+		// the texture is small enough to send at once; it covers the region until the mesh lands
+		MapRenderer::installRegionImpostor(regionX, regionY, region->colors, region->heights);
+		MapRenderer::installRegionObjects(regionX, regionY, region->objects, region->heights);
+		world.setObjects(regionX, regionY, std::move(region->objects));
+		collision.buildRegion(world, regionX, regionY);
+		if (MapRenderer::tileOverlay)
+		{
+			// workers mesh without overlays; rebuild with them here instead
+			MemoryStats::add(MemoryCategory::MeshStaging, -(long long)(region->vertices.capacity() * sizeof(Vertex)));
+			MapRenderer::uploadTileMesh(regionX, regionY, region->tiles);
+		}
+		else if (uploader.isRunning())
+			uploader.upload(regionX, regionY, std::move(region->vertices));
+		else
+			MapRenderer::queueRegionMesh(regionX, regionY, std::move(region->vertices));
+	}
+	// the home region is routable straight away; neighbours wait until needed
+	if (homeArrived)
+		refreshRouting();
+
+	MapRenderer::uploadPending(UPLOAD_BUDGET);
+	uploader.collect();
+	if (MapRenderer::hasPendingUploads() || uploader.isBusy())
+		MapRenderer::requestRedraw();
+
+	// keep the 3x3 block of regions around the camera target requested
+	const float regionSpan = WorldMap::REGION_SIZE * TerrainMesh::TILE_SIZE;
+	int centerX = MapRenderer::HOME_REGION_X + (int)std::floor(target.x / regionSpan);
+	int centerY = MapRenderer::HOME_REGION_Y - (int)std::floor(target.z / regionSpan);
+	regionCache.nextFrame();
+	for (int dx = -1; dx <= 1; ++dx)
+	{
+		for (int dy = -1; dy <= 1; ++dy)
+		{
+			streamer.request(centerX + dx, centerY + dy);
+			regionCache.touch(centerX + dx, centerY + dy);
+		}
+	}
+}
 
-	size_t len = allPoints.size();
-	if (len >= buffer.size())
+// frees the least recently viewed regions once the cache is over budget;
+// they are streamed in again if the camera comes back
+void evictRegions(RegionStreamer& streamer, GpuUploader& uploader)
+{
+	for (const auto& region : world.regions())
 	{
-		buffer.resize(len + 1);
+		int regionX = WorldMap::regionX(region.first);
+		int regionY = WorldMap::regionY(region.first);
+		const RegionObjects* objects = world.getObjects(regionX, regionY);
+		size_t cpuBytes = MapLoader::terrainBytes() + (objects ? objects->memoryBytes() : 0);
+		regionCache.setBytes(regionX, regionY, cpuBytes, MapRenderer::regionGpuBytes(regionX, regionY));
 	}
 
-	memcpy(buffer.data(), allPoints.c_str(), len);
-	buffer[len] = '\0';
+	// a mesh still in flight on the upload thread would land on an evicted
+	// region, and a route build may be reading any region
+	if (uploader.isBusy() || routesBuilding())
+		return;
 
-	ImVec2 size(160, 160);
-	ImGui::SetNextWindowBgAlpha(0.5f);
-	ImGui::InputTextMultiline("##savedPoints", buffer.data(), buffer.size(), size, ImGuiInputTextFlags_ReadOnly);
+	std::vector<std::pair<int, int>> evicted = regionCache.selectEvictions();
+	for (const auto& region : evicted)
+	{
+		int regionX = region.first;
+		int regionY = region.second;
+		TRACE_SCOPE("evictRegion", "load");
+		MapRenderer::removeRegion(regionX, regionY);
+		world.removeRegion(regionX, regionY);
+		collision.buildRegion(world, regionX, regionY);
+		seaRouter.removeRegion(regionX, regionY);
+		pendingRouting.erase(std::remove(pendingRouting.begin(), pendingRouting.end(), region), pendingRouting.end());
+		streamer.forget(regionX, regionY);
+		regionCache.remove(regionX, regionY);
+	}
 
-	ImGui::End();
+	// labels would otherwise keep joining ports through regions that are gone
+	if (!evicted.empty())
+	{
+		componentsDirty = true;
+		relabelComponents();
+	}
+}
+
+// sea clearance and component labels for streamed regions are built lazily,
+// so streaming never stalls a frame on them
+void refreshRouting()
+{
+	if (routesBuilding() || (pendingRouting.empty() && !componentsDirty))
+		return;
+
+	if (!pendingRouting.empty())
+	{
+		seaRouter.addRegions(pendingRouting, defaultThreadCount());
+		pendingRouting.clear();
+		componentsDirty = true;
+	}
+	relabelComponents();
+}
+
+void relabelComponents()
+{
+	if (!componentsDirty || routesBuilding())
+		return;
+
+	components.build(world, defaultThreadCount());
+	componentsDirty = false;
+	if (showComponents)
+		MapRenderer::uploadTileMeshes(world.regions());
+}
+
+// collision takes precedence over components when both overlays are on
+bool overlayColor(int x, int y, glm::vec3& color)
+{
+	if (showCollision && collision.isBlocked(x, y, 0))
+	{
+		color = glm::vec3(0.8f, 0.15f, 0.15f);
+		return true;
+	}
+	return showComponents && componentColor(x, y, color);
+}
+
+void updateTileOverlay()
+{
+	if (showComponents || showCollision)
+		MapRenderer::tileOverlay = overlayColor;
+	else
+		MapRenderer::tileOverlay = nullptr;
+	MapRenderer::uploadTileMeshes(world.regions());
+}
+
+bool componentColor(int x, int y, glm::vec3& color)
+{
+	int component = components.componentAt(x, y);
+	if (component < 0)
+		return false;
+
+	// water in blues, land in greens, hashed per component so neighbours differ
+	unsigned int h = (unsigned int)component * 2654435761u;
+	float shade = 0.35f + (h >> 24) / 255.0f * 0.65f;
+	float tint = ((h >> 16) & 0xFF) / 255.0f * 0.4f;
+	if (components.isWater(component))
+		color = glm::vec3(tint * 0.5f, tint + 0.2f, shade);
+	else
+		color = glm::vec3(tint + 0.2f, shade, tint * 0.5f);
+	return true;
 }
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include "RegionCache.h"
+#include "WorldMap.h"
+
+void RegionCache::add(int regionX, int regionY)
+{
+	// a region that just arrived counts as viewed, or it could be evicted before it is drawn
+	entries[WorldMap::regionId(regionX, regionY)].lastViewed = frame;
+}
+
+void RegionCache::remove(int regionX, int regionY)
+{
+	auto it = entries.find(WorldMap::regionId(regionX, regionY));
+	if (it == entries.end())
+		return;
+	cpuTotal -= it->second.cpuBytes;
+	gpuTotal -= it->second.gpuBytes;
+	entries.erase(it);
+}
+
+bool RegionCache::contains(int regionX, int regionY) const
+{
+	return entries.count(WorldMap::regionId(regionX, regionY)) != 0;
+}
+
+void RegionCache::setBytes(int regionX, int regionY, size_t cpuBytes, size_t gpuBytes)
+{
+	auto it = entries.find(WorldMap::regionId(regionX, regionY));
+	if (it == entries.end())
+		return;
+	cpuTotal += cpuBytes - it->second.cpuBytes;
+	gpuTotal += gpuBytes - it->second.gpuBytes;
+	it->second.cpuBytes = cpuBytes;
+	it->second.gpuBytes = gpuBytes;
+}
+
+void RegionCache::touch(int regionX, int regionY)
+{
+	auto it = entries.find(WorldMap::regionId(regionX, regionY));
+	if (it != entries.end())
+		it->second.lastViewed = frame;
+}
+
+void RegionCache::pin(int regionX, int regionY)
+{
+	auto it = entries.find(WorldMap::regionId(regionX, regionY));
+	if (it != entries.end())
+		it->second.pinned = true;
+}
+
+std::vector<std::pair<int, int>> RegionCache::selectEvictions() const
+{
+	std::vector<std::pair<int, int>> evictions;
+	if (cpuTotal <= cpuBudget && gpuTotal <= gpuBudget)
+		return evictions;
+
+	std::vector<std::pair<unsigned long long, int>> candidates;
+	for (const auto& entry : entries)
+		if (!entry.second.pinned && entry.second.lastViewed < frame)
+			candidates.push_back({ entry.second.lastViewed, entry.first });
+	std::sort(candidates.begin(), candidates.end());
+
+	size_t cpu = cpuTotal;
+	size_t gpu = gpuTotal;
+	for (const auto& candidate : candidates)
+	{
+		if (cpu <= cpuBudget && gpu <= gpuBudget)
+			break;
+		const Entry& entry = entries.at(candidate.second);
+		cpu -= entry.cpuBytes;
+		gpu -= entry.gpuBytes;
+		evictions.push_back({ WorldMap::regionX(candidate.second), WorldMap::regionY(candidate.second) });
+	}
+	return evictions;
+}
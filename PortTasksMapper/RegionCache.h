@@ -0,0 +1,57 @@
+#ifndef REGIONCACHE_H
+#define REGIONCACHE_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Bookkeeping for which streamed regions stay resident. It records when each
+// region was last in view and how much CPU and GPU memory it holds, and picks
+// the least recently viewed regions to evict once either total is over its
+// budget. Freeing is left to the owners of that memory, and evicted regions
+// are simply streamed in again when they come back into view.
+class RegionCache
+{
+public:
+	RegionCache(size_t cpuBudget, size_t gpuBudget) : cpuBudget(cpuBudget), gpuBudget(gpuBudget) {}
+	void setBudgets(size_t cpu, size_t gpu) { cpuBudget = cpu; gpuBudget = gpu; }
+
+	void add(int regionX, int regionY);
+	void remove(int regionX, int regionY);
+	bool contains(int regionX, int regionY) const;
+	// current footprint of a resident region
+	void setBytes(int regionX, int regionY, size_t cpuBytes, size_t gpuBytes);
+	// marks the region as in view for the current frame
+	void touch(int regionX, int regionY);
+	// pinned regions are never evicted (e.g. ones with edits)
+	void pin(int regionX, int regionY);
+	void nextFrame() { ++frame; }
+
+	// Least recently viewed first, as many as it takes to get both totals
+	// within budget. Regions viewed this frame and pinned ones are kept even
+	// if that leaves the cache over budget.
+	std::vector<std::pair<int, int>> selectEvictions() const;
+
+	size_t cpuBytes() const { return cpuTotal; }
+	size_t gpuBytes() const { return gpuTotal; }
+	int size() const { return (int)entries.size(); }
+
+private:
+	struct Entry
+	{
+		unsigned long long lastViewed = 0;
+		size_t cpuBytes = 0;
+		size_t gpuBytes = 0;
+		bool pinned = false;
+	};
+
+	std::unordered_map<int, Entry> entries;
+	size_t cpuBudget;
+	size_t gpuBudget;
+	size_t cpuTotal = 0;
+	size_t gpuTotal = 0;
+	unsigned long long frame = 1;
+};
+
+#endif // REGIONCACHE_H
@@ -0,0 +1,38 @@
+#ifndef REGIONOBJECTS_H
+#define REGIONOBJECTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Locations (scenery objects) of one region as parallel arrays, in the order
+// the l file lists them: grouped by object id, ascending. Seven bytes per
+// object, so a whole world of them stays small.
+struct RegionObjects
+{
+	std::vector<uint32_t> ids;
+	// as stored in the file: localY | localX << 6 | plane << 12
+	std::vector<uint16_t> positions;
+	// type << 2 | orientation
+	std::vector<uint8_t> shapes;
+
+	size_t size() const { return ids.size(); }
+	void clear()
+	{
+		ids.clear();
+		positions.clear();
+		shapes.clear();
+	}
+	size_t memoryBytes() const
+	{
+		return ids.capacity() * sizeof(uint32_t) + positions.capacity() * sizeof(uint16_t) + shapes.capacity();
+	}
+
+	static int localX(uint16_t position) { return position >> 6 & 0x3F; }
+	static int localY(uint16_t position) { return position & 0x3F; }
+	static int plane(uint16_t position) { return position >> 12 & 0x3; }
+	static int type(uint8_t shape) { return shape >> 2; }
+	static int orientation(uint8_t shape) { return shape & 0x3; }
+};
+
+#endif // REGIONOBJECTS_H
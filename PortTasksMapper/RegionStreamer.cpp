@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "RegionStreamer.h"
+#include "MapLoader.h"
+#include "MemoryStats.h"
+#include "Trace.h"
+#include "Utils.h"
+#include "WorldMap.h"
+
+RegionStreamer::RegionStreamer(const std::string& directory, int threads, std::function<void()> onReady, const XteaKeyStore* keys)
+	: directory(directory), onReady(onReady), keys(keys), threads(threads)
+{
+}
+
+RegionStreamer::~RegionStreamer()
+{
+	stop();
+}
+
+void RegionStreamer::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(requestMutex);
+		stopping = true;
+	}
+	for (std::unique_ptr<Job>& job : jobs)
+		JobSystem::wait(*job);
+	jobs.clear();
+
+	std::unique_ptr<StreamedRegion> region;
+	while (finished.pop(region))
+	{
+		MemoryStats::add(MemoryCategory::MeshStaging, -(long long)(region->vertices.capacity() * sizeof(Vertex)));
+		MapLoader::freeTerrain(region->tiles);
+	}
+}
+
+void RegionStreamer::request(int regionX, int regionY)
+{
+	if (regionX < 0 || regionY < 0 || regionX > 255 || regionY > 255)
+		return;
+	if (!requested.insert(WorldMap::regionId(regionX, regionY)).second)
+		return;
+
+	++outstanding;
+	{
+		std::lock_guard<std::mutex> lock(requestMutex);
+		requests.push_back({ regionX, regionY });
+		if (draining >= threads)
+			return;
+		++draining;
+	}
+
+	jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+		[](const std::unique_ptr<Job>& job) { return JobSystem::isDone(*job); }), jobs.end());
+	jobs.emplace_back(new Job());
+	jobs.back()->work = [this]() { drain(); };
+	JobSystem::run(*jobs.back());
+}
+
+bool RegionStreamer::poll(std::unique_ptr<StreamedRegion>& out)
+{
+	if (!finished.pop(out))
+		return false;
+	--outstanding;
+	return true;
+}
+
+bool RegionStreamer::wasRequested(int regionX, int regionY) const
+{
+	return requested.count(WorldMap::regionId(regionX, regionY)) != 0;
+}
+
+void RegionStreamer::forget(int regionX, int regionY)
+{
+	requested.erase(WorldMap::regionId(regionX, regionY));
+}
+
+void RegionStreamer::drain()
+{
+	for (;;)
+	{
+		std::pair<int, int> next;
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+			if (stopping || requests.empty())
+			{
+				--draining;
+				return;
+			}
+			next = requests.front();
+			requests.pop_front();
+		}
+		load(next.first, next.second);
+	}
+}
+
+void RegionStreamer::load(int regionX, int regionY)
+{
+	TRACE_SCOPE("streamRegion", "load");
+	std::unique_ptr<StreamedRegion> region(new StreamedRegion());
+	region->regionX = regionX;
+	region->regionY = regionY;
+	region->tiles = nullptr;
+
+	char path[512];
+	snprintf(path, sizeof(path), "%s/m%d_%d.dat", directory.c_str(), regionX, regionY);
+	size_t bufSize;
+	unsigned char* buf = loadFileBytes(path, &bufSize);
+	if (buf)
+	{
+		region->tiles = MapLoader::loadTerrain(buf, bufSize);
+		free(buf);
+
+		TRACE_SCOPE("buildMesh", "mesh");
+		TerrainMesh::smoothHeights(region->tiles, region->heights);
+		TerrainMesh::buildVertices(region->tiles, region->heights, nullptr, region->vertices);
+		TerrainMesh::bakeColors(region->tiles, nullptr, region->colors);
+		MemoryStats::add(MemoryCategory::MeshStaging, (long long)(region->vertices.capacity() * sizeof(Vertex)));
+
+		WorldMap::readObjects(regionX, regionY, directory.c_str(), keys, region->objects);
+	}
+
+	finished.push(std::move(region));
+	if (onReady)
+		onReady();
+}
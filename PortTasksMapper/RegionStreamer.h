@@ -0,0 +1,74 @@
+#ifndef REGIONSTREAMER_H
+#define REGIONSTREAMER_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+#include "MpscQueue.h"
+#include "TerrainMesh.h"
+#include "RegionObjects.h"
+#include "Xtea.h"
+
+// A region decoded and meshed off the GL thread. tiles is null when the
+// region file is missing or unreadable; objects stay empty without an l file.
+struct StreamedRegion
+{
+	int regionX;
+	int regionY;
+	Tile*** tiles;
+	std::vector<Vertex> vertices;
+	float heights[TerrainMesh::SIZE + 1][TerrainMesh::SIZE + 1];
+	unsigned char colors[TerrainMesh::SIZE * TerrainMesh::SIZE * 3];
+	RegionObjects objects;
+};
+
+// Loads, decodes and meshes requested regions as jobs on the shared pool, at
+// most `threads` at a time so streaming leaves cores for the rest. Finished
+// regions come back through a lock-free queue that the main thread drains
+// with poll(); the caller then owns the tiles. Each region is requested at
+// most once.
+class RegionStreamer
+{
+public:
+	// onReady runs on a worker after each region is queued (e.g. to wake the render loop);
+	// keys, if given, must outlive the streamer
+	RegionStreamer(const std::string& directory, int threads, std::function<void()> onReady, const XteaKeyStore* keys = nullptr);
+	~RegionStreamer();
+
+	// main thread only
+	void request(int regionX, int regionY);
+	bool poll(std::unique_ptr<StreamedRegion>& out);
+	bool wasRequested(int regionX, int regionY) const;
+	// lets an evicted region be requested (and loaded) again
+	void forget(int regionX, int regionY);
+	int inFlight() const { return outstanding; }
+	// waits for running loads and frees unclaimed regions; no onReady runs
+	// after it returns, so call it before tearing down what onReady touches
+	void stop();
+
+private:
+	void drain();
+	void load(int regionX, int regionY);
+
+	std::string directory;
+	std::function<void()> onReady;
+	const XteaKeyStore* keys;
+	int threads;
+	// main thread only; finished jobs are reclaimed as new ones start
+	std::vector<std::unique_ptr<Job>> jobs;
+	std::mutex requestMutex;
+	std::deque<std::pair<int, int>> requests;
+	int draining = 0;
+	bool stopping = false;
+
+	MpscQueue<std::unique_ptr<StreamedRegion>> finished;
+	std::set<int> requested;
+	int outstanding = 0;
+};
+
+#endif // REGIONSTREAMER_H
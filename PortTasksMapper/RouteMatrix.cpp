@@ -0,0 +1,337 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <set>
+#include "RouteMatrix.h"
+#include "PathExporter.h"
+#include "Utils.h"
+
+RouteMatrix::RouteMatrix(const WorldMap& world, const SeaRouter& router)
+	: world(world), router(router)
+{
+}
+
+void RouteMatrix::addPort(const std::string& name, const WorldPoint& dock)
+{
+	ports.push_back({ name, dock });
+}
+
+bool RouteMatrix::loadPorts(const char* filename)
+{
+	FILE* file = fopen(filename, "r");
+	if (!file) return false;
+
+	char line[256];
+	while (fgets(line, sizeof(line), file))
+	{
+		char name[128];
+		WorldPoint dock;
+		if (line[0] != '#' && sscanf(line, "%127s %d %d %d", name, &dock.x, &dock.y, &dock.plane) == 4)
+			addPort(name, dock);
+	}
+	fclose(file);
+	return true;
+}
+
+size_t RouteMatrix::CacheKeyHash::operator()(const CacheKey& key) const
+{
+	const int fields[7] = { key.from.x, key.from.y, key.from.plane, key.to.x, key.to.y, key.to.plane, key.clearance };
+	size_t hash = 1469598103934665603ULL;
+	for (int field : fields)
+	{
+		hash ^= (size_t)(unsigned int)field;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+unsigned long long RouteMatrix::currentHash(unsigned int regionId) const
+{
+	// unloaded regions hash to 0, as in WorldMap::regionHash
+	auto it = regionHashes.find(regionId);
+	return it == regionHashes.end() ? 0 : it->second;
+}
+
+bool RouteMatrix::isCurrent(const CacheEntry& entry) const
+{
+	for (const auto& region : entry.regions)
+	{
+		if (currentHash(region.first) != region.second)
+			return false;
+	}
+	return true;
+}
+
+RouteMatrix::CacheEntry RouteMatrix::makeEntry(const std::vector<WorldPoint>& points) const
+{
+	std::set<int> crossed;
+	for (const WorldPoint& p : points)
+		crossed.insert(WorldMap::regionId(p.x / WorldMap::REGION_SIZE, p.y / WorldMap::REGION_SIZE));
+
+	CacheEntry entry;
+	entry.points = points;
+	for (int id : crossed)
+		entry.regions.push_back({ (unsigned int)id, currentHash((unsigned int)id) });
+	return entry;
+}
+
+void RouteMatrix::build(int minClearance, int threads)
+{
+	std::vector<std::pair<int, int>> pairs;
+	for (int i = 0; i < (int)ports.size(); ++i)
+		for (int j = i + 1; j < (int)ports.size(); ++j)
+			pairs.push_back({ i, j });
+
+	std::vector<PortRoute> results(pairs.size());
+	std::vector<char> reused(pairs.size(), 0);
+	std::vector<char> rejected(pairs.size(), 0);
+
+	// every cached entry and new route compares against these, so each region
+	// is hashed once rather than once per pair crossing it
+	std::vector<int> ids = world.regionIds();
+	std::vector<unsigned long long> hashes(ids.size());
+	parallelFor((int)ids.size(), threads, [&](int i)
+	{
+		hashes[i] = world.regionHash(WorldMap::regionX(ids[i]), WorldMap::regionY(ids[i]));
+	});
+	regionHashes.clear();
+	for (size_t i = 0; i < ids.size(); ++i)
+		regionHashes[(unsigned int)ids[i]] = hashes[i];
+
+	std::vector<int> body(ports.size(), -1);
+	if (components)
+	{
+		for (size_t i = 0; i < ports.size(); ++i)
+		{
+			WorldPoint water = ports[i].dock;
+			if (router.snapToWater(water))
+				body[i] = components->componentAt(water.x, water.y);
+		}
+	}
+
+	// cache lookups only read, so they can run alongside the searches
+	parallelFor((int)pairs.size(), threads, [&](int i)
+	{
+		const WorldPoint& from = ports[pairs[i].first].dock;
+		const WorldPoint& to = ports[pairs[i].second].dock;
+		PortRoute& route = results[i];
+		route.from = pairs[i].first;
+		route.to = pairs[i].second;
+
+		if (components && body[route.from] != body[route.to])
+		{
+			rejected[i] = 1;
+			return;
+		}
+
+		auto it = cache.find({ from, to, minClearance });
+		if (it != cache.end() && isCurrent(it->second))
+		{
+			route.points = it->second.points;
+			route.cached = true;
+			reused[i] = 1;
+			return;
+		}
+
+		route.points = router.findRoute(from, to, minClearance);
+		route.cached = false;
+	});
+
+	routes.clear();
+	cachedCount = 0;
+	rejectedCount = 0;
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		rejectedCount += rejected[i];
+		PortRoute& route = results[i];
+		if (route.points.empty())
+			continue;
+
+		if (reused[i])
+			++cachedCount;
+		else
+			cache[{ ports[route.from].dock, ports[route.to].dock, minClearance }] = makeEntry(route.points);
+		routes.push_back(std::move(route));
+	}
+}
+
+std::vector<Path> RouteMatrix::toPaths() const
+{
+	std::vector<Path> paths;
+	for (const PortRoute& route : routes)
+		paths.push_back({ ports[route.from].name + " -> " + ports[route.to].name, route.points });
+	return paths;
+}
+
+bool RouteMatrix::loadCache(const char* filename)
+{
+	FILE* file = fopen(filename, "rb");
+	if (!file) return false;
+
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	rewind(file);
+	// counts are checked against what is left of the file before anything is
+	// allocated, so a truncated or corrupt cache cannot ask for gigabytes
+	auto fits = [&](unsigned int count, size_t itemSize)
+	{
+		long remaining = fileSize - ftell(file);
+		return remaining >= 0 && (unsigned long long)count * itemSize <= (unsigned long long)remaining;
+	};
+	const size_t regionRecord = sizeof(unsigned int) + sizeof(unsigned long long);
+
+	bool ok = false;
+	char magic[4];
+	unsigned short version;
+	unsigned int count;
+	if (fread(magic, 1, 4, file) == 4 && !memcmp(magic, "PTRC", 4)
+		&& fread(&version, sizeof(version), 1, file) == 1 && version == CACHE_VERSION
+		&& fread(&count, sizeof(count), 1, file) == 1)
+	{
+		ok = true;
+		for (unsigned int e = 0; e < count && ok; ++e)
+		{
+			int header[7];
+			unsigned int regionCount, pointCount;
+			ok = fread(header, sizeof(int), 7, file) == 7 && fread(&regionCount, sizeof(regionCount), 1, file) == 1
+				&& fits(regionCount, regionRecord);
+			if (!ok) break;
+
+			CacheEntry entry;
+			entry.regions.resize(regionCount);
+			for (auto& region : entry.regions)
+				ok = ok && fread(&region.first, sizeof(region.first), 1, file) == 1 && fread(&region.second, sizeof(region.second), 1, file) == 1;
+			ok = ok && fread(&pointCount, sizeof(pointCount), 1, file) == 1 && fits(pointCount, sizeof(WorldPoint));
+			if (!ok) break;
+
+			entry.points.resize(pointCount);
+			ok = fread(entry.points.data(), sizeof(WorldPoint), pointCount, file) == pointCount;
+
+			CacheKey key = { { header[0], header[1], header[2] }, { header[3], header[4], header[5] }, header[6] };
+			if (ok)
+				cache[key] = std::move(entry);
+		}
+	}
+	fclose(file);
+	if (!ok)
+	{
+		fprintf(stderr, "%s is not a valid route cache; ignoring it\n", filename);
+		cache.clear();
+	}
+	return ok;
+}
+
+bool RouteMatrix::saveCache(const char* filename) const
+{
+	FILE* file = fopen(filename, "wb");
+	if (!file) return false;
+
+	unsigned short version = CACHE_VERSION;
+	unsigned int count = (unsigned int)cache.size();
+	fwrite("PTRC", 1, 4, file);
+	fwrite(&version, sizeof(version), 1, file);
+	fwrite(&count, sizeof(count), 1, file);
+
+	for (const auto& item : cache)
+	{
+		const CacheKey& key = item.first;
+		const int header[7] = { key.from.x, key.from.y, key.from.plane, key.to.x, key.to.y, key.to.plane, key.clearance };
+		fwrite(header, sizeof(int), 7, file);
+
+		unsigned int regionCount = (unsigned int)item.second.regions.size();
+		fwrite(&regionCount, sizeof(regionCount), 1, file);
+		for (const auto& region : item.second.regions)
+		{
+			fwrite(&region.first, sizeof(region.first), 1, file);
+			fwrite(&region.second, sizeof(region.second), 1, file);
+		}
+
+		unsigned int pointCount = (unsigned int)item.second.points.size();
+		fwrite(&pointCount, sizeof(pointCount), 1, file);
+		fwrite(item.second.points.data(), sizeof(WorldPoint), pointCount, file);
+	}
+
+	return fclose(file) == 0;
+}
+
+int RouteMatrix::runCommand(int argc, char** argv)
+{
+	const char* portsFile = nullptr;
+	const char* mapDir = ".";
+	const char* cacheFile = "routes.cache";
+	const char* outBase = "routes";
+	int clearance = 2;
+	int margin = 1;
+	int threads = defaultThreadCount();
+
+	for (int i = 1; i + 1 < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--routes"))
+			portsFile = argv[++i];
+		else if (!strcmp(argv[i], "--maps"))
+			mapDir = argv[++i];
+		else if (!strcmp(argv[i], "--cache"))
+			cacheFile = argv[++i];
+		else if (!strcmp(argv[i], "--out"))
+			outBase = argv[++i];
+		else if (!strcmp(argv[i], "--clearance"))
+			clearance = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--margin"))
+			margin = std::max(0, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--threads"))
+			threads = std::max(1, atoi(argv[++i]));
+	}
+
+	if (!portsFile)
+	{
+		fprintf(stderr, "usage: %s --routes ports.txt [--maps dir] [--cache file] [--out base] [--clearance n] [--margin n] [--threads n]\n", argv[0]);
+		return 2;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	WorldMap world;
+	world.setCompressed(true);
+	SeaRouter router(world);
+	RouteMatrix matrix(world, router);
+	if (!matrix.loadPorts(portsFile))
+	{
+		fprintf(stderr, "Failed to read %s\n", portsFile);
+		return 2;
+	}
+
+	// load every region in the bounding box of the ports, plus a margin so
+	// routes can swing around coastlines outside it
+	int minX = 1 << 30, minY = 1 << 30, maxX = 0, maxY = 0;
+	for (const Port& port : matrix.getPorts())
+	{
+		minX = std::min(minX, port.dock.x / WorldMap::REGION_SIZE);
+		minY = std::min(minY, port.dock.y / WorldMap::REGION_SIZE);
+		maxX = std::max(maxX, port.dock.x / WorldMap::REGION_SIZE);
+		maxY = std::max(maxY, port.dock.y / WorldMap::REGION_SIZE);
+	}
+	std::vector<std::pair<int, int>> box;
+	for (int rx = std::max(0, minX - margin); rx <= maxX + margin; ++rx)
+		for (int ry = std::max(0, minY - margin); ry <= maxY + margin; ++ry)
+			box.push_back({ rx, ry });
+	std::vector<std::pair<int, int>> loaded = world.loadRegions(box, mapDir, threads);
+	router.addRegions(loaded, threads);
+
+	WorldComponents components;
+	components.build(world, threads);
+	matrix.setComponents(&components);
+
+	matrix.loadCache(cacheFile);
+	matrix.build(clearance, threads);
+
+	bool ok = matrix.saveCache(cacheFile) && PathExporter::writeAll(matrix.toPaths(), outBase);
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	int pairs = (int)(matrix.getPorts().size() * (matrix.getPorts().size() - 1) / 2);
+	printf("{\"ports\":%d,\"pairs\":%d,\"routes\":%d,\"cached\":%d,\"rejected\":%d,\"regions\":%d,\"elapsedMs\":%.1f}\n",
+		(int)matrix.getPorts().size(), pairs, (int)matrix.getRoutes().size(), matrix.getCachedCount(), matrix.getRejectedCount(), (int)loaded.size(), elapsedMs);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#ifndef ROUTEMATRIX_H
+#define ROUTEMATRIX_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Path.h"
+#include "SeaRouter.h"
+#include "WorldMap.h"
+#include "WorldComponents.h"
+
+struct Port
+{
+	std::string name;
+	WorldPoint dock;
+};
+
+struct PortRoute
+{
+	int from;
+	int to;
+	std::vector<WorldPoint> points;
+	bool cached;
+};
+
+// Computes a sea route between every pair of registered ports on worker
+// threads. Results are cached on disk together with a hash of each region
+// the route crosses; a cached route is reused as long as its endpoints,
+// clearance and all of those region hashes still match. Failed searches
+// are not cached.
+//
+// Cache layout (native endian):
+//   "PTRC" u16 version u32 entryCount
+//   per entry: i32 fromX fromY fromPlane toX toY toPlane clearance,
+//              u32 regionCount, regionCount x (u32 regionId, u64 hash),
+//              u32 pointCount, pointCount x (i32 x, y, plane)
+class RouteMatrix
+{
+public:
+	static const unsigned short CACHE_VERSION = 1;
+
+	RouteMatrix(const WorldMap& world, const SeaRouter& router);
+
+	void addPort(const std::string& name, const WorldPoint& dock);
+	// one port per line: name x y plane (name may not contain spaces)
+	bool loadPorts(const char* filename);
+	const std::vector<Port>& getPorts() const { return ports; }
+	// when set, pairs whose docks lie on different water bodies are skipped
+	// without a search
+	void setComponents(const WorldComponents* components) { this->components = components; }
+
+	bool loadCache(const char* filename);
+	bool saveCache(const char* filename) const;
+
+	// fills `routes` with every pair i < j that has a route
+	void build(int minClearance, int threads);
+	const std::vector<PortRoute>& getRoutes() const { return routes; }
+	int getCachedCount() const { return cachedCount; }
+	int getRejectedCount() const { return rejectedCount; }
+	std::vector<Path> toPaths() const;
+
+	// --routes entry point: PortTasksMapper --routes ports.txt [--maps dir]
+	// [--cache file] [--out base] [--clearance n] [--margin n] [--threads n]
+	static int runCommand(int argc, char** argv);
+
+private:
+	struct CacheKey
+	{
+		WorldPoint from;
+		WorldPoint to;
+		int clearance;
+
+		bool operator==(const CacheKey& other) const
+		{
+			return from == other.from && to == other.to && clearance == other.clearance;
+		}
+	};
+	struct CacheKeyHash
+	{
+		size_t operator()(const CacheKey& key) const;
+	};
+	struct CacheEntry
+	{
+		std::vector<std::pair<unsigned int, unsigned long long>> regions;
+		std::vector<WorldPoint> points;
+	};
+
+	bool isCurrent(const CacheEntry& entry) const;
+	CacheEntry makeEntry(const std::vector<WorldPoint>& points) const;
+	unsigned long long currentHash(unsigned int regionId) const;
+
+	const WorldMap& world;
+	const SeaRouter& router;
+	const WorldComponents* components = nullptr;
+	std::vector<Port> ports;
+	std::vector<PortRoute> routes;
+	std::unordered_map<CacheKey, CacheEntry, CacheKeyHash> cache;
+	// hash of every loaded region, taken once per build
+	std::unordered_map<unsigned int, unsigned long long> regionHashes;
+	int cachedCount = 0;
+	int rejectedCount = 0;
+};
+
+#endif // ROUTEMATRIX_H
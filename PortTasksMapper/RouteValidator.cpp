@@ -0,0 +1,211 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include "RouteValidator.h"
+#include "PathSimplifier.h"
+#include "Utils.h"
+
+namespace
+{
+	void writeJsonString(FILE* out, const std::string& text)
+	{
+		fputc('"', out);
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				fprintf(out, "\\%c", c);
+			else if ((unsigned char)c < 0x20)
+				fprintf(out, "\\u%04x", c);
+			else
+				fputc(c, out);
+		}
+		fputc('"', out);
+	}
+}
+
+RouteValidator::RouteValidator(const WorldMap& world, int maxStep)
+	: world(world), maxStep(maxStep)
+{
+}
+
+void RouteValidator::validateRoute(const Path& route, int routeIndex, std::vector<RouteIssue>& out) const
+{
+	const std::vector<WorldPoint>& points = route.points;
+
+	// a route whose loaded points are all water is a sea route
+	bool seaRoute = false;
+	for (const WorldPoint& p : points)
+	{
+		Tile tile;
+		if (!world.tileAt(p.x, p.y, 0, tile))
+			continue;
+		seaRoute = world.isWater(p.x, p.y);
+		if (!seaRoute)
+			break;
+	}
+
+	TilePredicate passable = [this, seaRoute](int x, int y, int plane)
+	{
+		return seaRoute ? world.isWater(x, y) : world.isWalkable(x, y, plane);
+	};
+
+	for (int i = 0; i < (int)points.size(); ++i)
+	{
+		const WorldPoint& p = points[i];
+
+		Tile tile;
+		if (p.plane < 0 || p.plane > 3)
+		{
+			out.push_back({ routeIndex, i, p, "wrong_plane" });
+			continue;
+		}
+		if (!world.tileAt(p.x, p.y, p.plane, tile))
+		{
+			out.push_back({ routeIndex, i, p, "unloaded_region" });
+			continue;
+		}
+		if (p.plane > 0 && tile.underlayId == 0 && tile.overlayId == 0)
+			out.push_back({ routeIndex, i, p, "wrong_plane" });
+		else if (!passable(p.x, p.y, p.plane))
+			out.push_back({ routeIndex, i, p, "blocked" });
+
+		if (i == 0)
+			continue;
+
+		const WorldPoint& prev = points[i - 1];
+		int step = std::max(std::abs(p.x - prev.x), std::abs(p.y - prev.y));
+		if (p.plane != prev.plane || step > maxStep)
+			out.push_back({ routeIndex, i, p, "jump" });
+		else if (step > 1 && !PathSimplifier::lineOfSight(prev, p, passable))
+			out.push_back({ routeIndex, i, p, "blocked_segment" });
+	}
+}
+
+std::vector<RouteIssue> RouteValidator::validate(const std::vector<Path>& routes) const
+{
+	std::vector<RouteIssue> issues;
+	for (int i = 0; i < (int)routes.size(); ++i)
+		validateRoute(routes[i], i, issues);
+	return issues;
+}
+
+int RouteValidator::runCommand(int argc, char** argv)
+{
+	const char* mapDir = ".";
+	const char* reportPath = nullptr;
+	int maxStep = 1;
+	int threads = defaultThreadCount();
+	std::vector<RouteFile> files;
+
+	for (int i = 2; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--maps") && i + 1 < argc)
+			mapDir = argv[++i];
+		else if (!strcmp(argv[i], "--report") && i + 1 < argc)
+			reportPath = argv[++i];
+		else if (!strcmp(argv[i], "--max-step") && i + 1 < argc)
+			maxStep = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+			threads = std::max(1, atoi(argv[++i]));
+		else
+			files.push_back({ argv[i], {} });
+	}
+
+	if (files.empty())
+	{
+		fprintf(stderr, "usage: %s --validate [--maps dir] [--report file] [--max-step n] [--threads n] routes...\n", argv[0]);
+		return 2;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::atomic<bool> readFailed(false);
+	parallelFor((int)files.size(), threads, [&](int i)
+	{
+		if (!loadPathFile(files[i].filename.c_str(), files[i].routes))
+		{
+			fprintf(stderr, "Failed to read %s\n", files[i].filename.c_str());
+			readFailed = true;
+		}
+	});
+
+	// every region touched by any route
+	std::set<int> needed;
+	for (const RouteFile& file : files)
+		for (const Path& route : file.routes)
+			for (const WorldPoint& p : route.points)
+				if (p.x >= 0 && p.y >= 0)
+					needed.insert(WorldMap::regionId(p.x / WorldMap::REGION_SIZE, p.y / WorldMap::REGION_SIZE));
+
+	std::vector<std::pair<int, int>> regionCoords;
+	for (int id : needed)
+		regionCoords.push_back({ WorldMap::regionX(id), WorldMap::regionY(id) });
+
+	WorldMap world;
+	world.setCompressed(true);
+	size_t loadedCount = world.loadRegions(regionCoords, mapDir, threads).size();
+
+	// one task per route across all files
+	std::vector<std::pair<int, int>> tasks;
+	for (int f = 0; f < (int)files.size(); ++f)
+		for (int r = 0; r < (int)files[f].routes.size(); ++r)
+			tasks.push_back({ f, r });
+
+	RouteValidator validator(world, maxStep);
+	std::vector<std::vector<RouteIssue>> results(tasks.size());
+	parallelFor((int)tasks.size(), threads, [&](int i)
+	{
+		validator.validateRoute(files[tasks[i].first].routes[tasks[i].second], tasks[i].second, results[i]);
+	});
+
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	FILE* out = reportPath ? fopen(reportPath, "w") : stdout;
+	if (!out)
+	{
+		fprintf(stderr, "Failed to open %s\n", reportPath);
+		return 2;
+	}
+
+	size_t pointCount = 0;
+	size_t issueCount = 0;
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		pointCount += files[tasks[i].first].routes[tasks[i].second].points.size();
+		issueCount += results[i].size();
+	}
+
+	fprintf(out, "{\n\"files\":%d,\"routes\":%d,\"points\":%zu,\"regions\":%d,\"regionsMissing\":%d,\"issueCount\":%zu,\"elapsedMs\":%.1f,\n",
+		(int)files.size(), (int)tasks.size(), pointCount, (int)regionCoords.size(),
+		(int)(regionCoords.size() - loadedCount), issueCount, elapsedMs);
+	fprintf(out, "\"issues\":[");
+	bool first = true;
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		const RouteFile& file = files[tasks[i].first];
+		for (const RouteIssue& issue : results[i])
+		{
+			fprintf(out, first ? "\n{\"file\":" : ",\n{\"file\":");
+			writeJsonString(out, file.filename);
+			fprintf(out, ",\"route\":");
+			writeJsonString(out, file.routes[issue.route].name);
+			fprintf(out, ",\"index\":%d,\"x\":%d,\"y\":%d,\"plane\":%d,\"type\":\"%s\"}",
+				issue.index, issue.point.x, issue.point.y, issue.point.plane, issue.type);
+			first = false;
+		}
+	}
+	fprintf(out, "\n]}\n");
+
+	if (out != stdout)
+		fclose(out);
+
+	if (readFailed)
+		return 2;
+	return issueCount ? 1 : 0;
+}
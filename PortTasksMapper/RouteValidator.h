@@ -0,0 +1,49 @@
+#ifndef ROUTEVALIDATOR_H
+#define ROUTEVALIDATOR_H
+
+#include <string>
+#include <vector>
+#include "Path.h"
+#include "WorldMap.h"
+
+struct RouteIssue
+{
+	int route;
+	int index;
+	WorldPoint point;
+	const char* type;
+};
+
+struct RouteFile
+{
+	std::string filename;
+	std::vector<Path> routes;
+};
+
+// Checks plugin routes against decoded terrain without a window or GL context.
+//
+// Issue types:
+//   unloaded_region  point lies in a region whose map file was not found
+//   wrong_plane      plane outside 0-3, or no floor on that plane
+//   blocked          sea route point off water, or walking route point on a
+//                    blocked or water tile
+//   jump             step longer than maxStep tiles, or across planes
+//   blocked_segment  a multi-tile step whose straight line crosses a blocked tile
+class RouteValidator
+{
+public:
+	explicit RouteValidator(const WorldMap& world, int maxStep = 1);
+
+	std::vector<RouteIssue> validate(const std::vector<Path>& routes) const;
+	void validateRoute(const Path& route, int routeIndex, std::vector<RouteIssue>& out) const;
+
+	// --validate entry point: PortTasksMapper --validate [--maps dir]
+	// [--report file] [--max-step n] [--threads n] files...
+	static int runCommand(int argc, char** argv);
+
+private:
+	const WorldMap& world;
+	int maxStep;
+};
+
+#endif // ROUTEVALIDATOR_H
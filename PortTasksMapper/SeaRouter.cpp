@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include "SeaRouter.h"
+#include "Utils.h"
+
+namespace
+{
+	const int PAD = SeaRouter::MAX_CLEARANCE;
+	const int GRID = WorldMap::REGION_SIZE + 2 * PAD;
+	const float INF = 1e20f;
+
+	// extra cost per step is SHORE_WEIGHT / clearance, so routes drift toward open water
+	const float SHORE_WEIGHT = 4.0f;
+	const size_t MAX_EXPANSIONS = 4000000;
+
+	// 1D squared distance transform (Felzenszwalb & Huttenlocher)
+	void distanceTransform1D(const float* f, float* d, int n, int* v, float* z)
+	{
+		int k = 0;
+		v[0] = 0;
+		z[0] = -INF;
+		z[1] = INF;
+		for (int q = 1; q < n; ++q)
+		{
+			float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+			while (s <= z[k])
+			{
+				--k;
+				s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+			}
+			++k;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = INF;
+		}
+		k = 0;
+		for (int q = 0; q < n; ++q)
+		{
+			while (z[k + 1] < q)
+				++k;
+			d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+		}
+	}
+
+	long long nodeKey(int x, int y)
+	{
+		return (long long)x << 32 | (unsigned int)y;
+	}
+
+	int chebyshev(int x0, int y0, int x1, int y1)
+	{
+		return std::max(std::abs(x0 - x1), std::abs(y0 - y1));
+	}
+}
+
+SeaRouter::SeaRouter(const WorldMap& world)
+	: world(world)
+{
+}
+
+void SeaRouter::addRegion(int regionX, int regionY)
+{
+	// the grid is padded with neighbouring regions so shores just across a
+	// border still count; loaded neighbours are refreshed for the same reason
+	for (int dy = -1; dy <= 1; ++dy)
+	{
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			int rx = regionX + dx;
+			int ry = regionY + dy;
+			if ((dx == 0 && dy == 0) || clearance.count(WorldMap::regionId(rx, ry)))
+				computeClearance(rx, ry);
+		}
+	}
+}
+
+void SeaRouter::addRegions(const std::vector<std::pair<int, int>>& regions, int threads)
+{
+	// create every slot up front so the workers never rehash the map
+	std::vector<std::vector<unsigned char>*> slots;
+	for (const auto& region : regions)
+		slots.push_back(&clearance[WorldMap::regionId(region.first, region.second)]);
+
+	parallelFor((int)regions.size(), threads, [&](int i)
+	{
+		computeClearance(regions[i].first, regions[i].second, *slots[i]);
+	});
+}
+
+void SeaRouter::removeRegion(int regionX, int regionY)
+{
+	clearance.erase(WorldMap::regionId(regionX, regionY));
+}
+
+void SeaRouter::computeClearance(int regionX, int regionY)
+{
+	computeClearance(regionX, regionY, clearance[WorldMap::regionId(regionX, regionY)]);
+}
+
+void SeaRouter::computeClearance(int regionX, int regionY, std::vector<unsigned char>& out) const
+{
+	const int baseX = regionX * WorldMap::REGION_SIZE - PAD;
+	const int baseY = regionY * WorldMap::REGION_SIZE - PAD;
+
+	// land is a distance-0 seed; water and unloaded tiles are unbounded
+	std::vector<float> grid(GRID * GRID);
+	for (int x = 0; x < GRID; ++x)
+	{
+		for (int y = 0; y < GRID; ++y)
+		{
+			Tile tile;
+			bool land = world.tileAt(baseX + x, baseY + y, 0, tile) && !world.isWater(baseX + x, baseY + y);
+			grid[x * GRID + y] = land ? 0.0f : INF;
+		}
+	}
+
+	std::vector<float> f(GRID), d(GRID), z(GRID + 1);
+	std::vector<int> v(GRID);
+	for (int x = 0; x < GRID; ++x)
+	{
+		distanceTransform1D(&grid[x * GRID], d.data(), GRID, v.data(), z.data());
+		std::copy(d.begin(), d.end(), grid.begin() + x * GRID);
+	}
+	for (int y = 0; y < GRID; ++y)
+	{
+		for (int x = 0; x < GRID; ++x)
+			f[x] = grid[x * GRID + y];
+		distanceTransform1D(f.data(), d.data(), GRID, v.data(), z.data());
+		for (int x = 0; x < GRID; ++x)
+			grid[x * GRID + y] = d[x];
+	}
+
+	out.assign(WorldMap::REGION_SIZE * WorldMap::REGION_SIZE, 0);
+	for (int x = 0; x < WorldMap::REGION_SIZE; ++x)
+	{
+		for (int y = 0; y < WorldMap::REGION_SIZE; ++y)
+		{
+			float dist = std::sqrt(grid[(x + PAD) * GRID + (y + PAD)]);
+			out[x * WorldMap::REGION_SIZE + y] = (unsigned char)std::min((float)MAX_CLEARANCE, std::floor(dist));
+		}
+	}
+}
+
+int SeaRouter::clearanceAt(int x, int y) const
+{
+	if (x < 0 || y < 0)
+		return 0;
+
+	auto it = clearance.find(WorldMap::regionId(x / WorldMap::REGION_SIZE, y / WorldMap::REGION_SIZE));
+	if (it == clearance.end())
+		return 0;
+
+	return it->second[(x % WorldMap::REGION_SIZE) * WorldMap::REGION_SIZE + (y % WorldMap::REGION_SIZE)];
+}
+
+size_t SeaRouter::memoryBytes() const
+{
+	size_t bytes = clearance.bucket_count() * sizeof(void*);
+	for (const auto& region : clearance)
+		bytes += sizeof(region) + region.second.capacity();
+	return bytes;
+}
+
+bool SeaRouter::snapToWater(WorldPoint& point) const
+{
+	if (clearanceAt(point.x, point.y) > 0)
+		return true;
+
+	for (int r = 1; r <= SNAP_RADIUS; ++r)
+	{
+		int best = -1;
+		WorldPoint bestPoint = point;
+		for (int dx = -r; dx <= r; ++dx)
+		{
+			for (int dy = -r; dy <= r; ++dy)
+			{
+				if (std::max(std::abs(dx), std::abs(dy)) != r)
+					continue;
+				int c = clearanceAt(point.x + dx, point.y + dy);
+				if (c > best && c > 0)
+				{
+					best = c;
+					bestPoint = { point.x + dx, point.y + dy, point.plane };
+				}
+			}
+		}
+		if (best > 0)
+		{
+			point = bestPoint;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<WorldPoint> SeaRouter::findRoute(const WorldPoint& from, const WorldPoint& to, int minClearance) const
+{
+	WorldPoint start = from;
+	WorldPoint goal = to;
+	if (!snapToWater(start) || !snapToWater(goal))
+		return {};
+
+	const int relaxRadius = std::max(minClearance, 1) * 2;
+	auto passable = [&](int x, int y)
+	{
+		int c = clearanceAt(x, y);
+		if (c >= minClearance && c > 0)
+			return true;
+		return c > 0 && (chebyshev(x, y, start.x, start.y) <= relaxRadius || chebyshev(x, y, goal.x, goal.y) <= relaxRadius);
+	};
+
+	auto heuristic = [&](int x, int y)
+	{
+		int dx = std::abs(x - goal.x);
+		int dy = std::abs(y - goal.y);
+		return (float)std::max(dx, dy) + 0.41421356f * std::min(dx, dy);
+	};
+
+	struct Node
+	{
+		float g;
+		long long parent;
+		bool closed;
+	};
+
+	typedef std::pair<float, long long> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+	std::unordered_map<long long, Node> nodes;
+
+	const long long startKey = nodeKey(start.x, start.y);
+	const long long goalKey = nodeKey(goal.x, goal.y);
+	nodes[startKey] = { 0.0f, startKey, false };
+	open.push({ heuristic(start.x, start.y), startKey });
+
+	static const int DX[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+	static const int DY[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+
+	size_t expansions = 0;
+	bool found = false;
+	while (!open.empty() && expansions < MAX_EXPANSIONS)
+	{
+		long long key = open.top().second;
+		open.pop();
+
+		Node& node = nodes[key];
+		if (node.closed)
+			continue;
+		node.closed = true;
+		++expansions;
+
+		if (key == goalKey)
+		{
+			found = true;
+			break;
+		}
+
+		int x = (int)(key >> 32);
+		int y = (int)(unsigned int)key;
+		float g = node.g;
+
+		for (int i = 0; i < 8; ++i)
+		{
+			int nx = x + DX[i];
+			int ny = y + DY[i];
+			if (!passable(nx, ny))
+				continue;
+			// no cutting corners past a shore tile
+			if (i >= 4 && (!passable(x + DX[i], y) || !passable(x, y + DY[i])))
+				continue;
+
+			float step = (i >= 4 ? 1.41421356f : 1.0f) * (1.0f + SHORE_WEIGHT / clearanceAt(nx, ny));
+			long long nkey = nodeKey(nx, ny);
+			auto it = nodes.find(nkey);
+			if (it != nodes.end() && (it->second.closed || it->second.g <= g + step))
+				continue;
+
+			nodes[nkey] = { g + step, key, false };
+			open.push({ g + step + heuristic(nx, ny), nkey });
+		}
+	}
+
+	if (!found)
+		return {};
+
+	std::vector<WorldPoint> route;
+	for (long long key = goalKey;; key = nodes[key].parent)
+	{
+		route.push_back({ (int)(key >> 32), (int)(unsigned int)key, from.plane });
+		if (key == startKey)
+			break;
+	}
+	std::reverse(route.begin(), route.end());
+	return route;
+}
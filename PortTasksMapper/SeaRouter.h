@@ -0,0 +1,46 @@
+#ifndef SEAROUTER_H
+#define SEAROUTER_H
+
+#include <unordered_map>
+#include <vector>
+#include "WorldMap.h"
+#include "WorldPoint.h"
+
+// Finds ship routes across water tiles. Each region gets a clearance grid
+// (distance in tiles to the nearest shore) when it is added, so a route
+// query is only a weighted A* over those precomputed values.
+class SeaRouter
+{
+public:
+	static const int MAX_CLEARANCE = 32;
+	static const int SNAP_RADIUS = 10;
+
+	explicit SeaRouter(const WorldMap& world);
+
+	void addRegion(int regionX, int regionY);
+	// bulk form for regions that are all already in the world map; each
+	// region's grid is computed once, in parallel
+	void addRegions(const std::vector<std::pair<int, int>>& regions, int threads);
+	// drops the region's grid (after it left the world map)
+	void removeRegion(int regionX, int regionY);
+	int clearanceAt(int x, int y) const;
+	size_t memoryBytes() const;
+
+	// Returns an 8-connected list of water tiles from `from` to `to` that stays
+	// at least minClearance tiles from shore, or an empty list if none exists.
+	// Endpoints on land snap to the nearest water tile within SNAP_RADIUS, and
+	// the clearance requirement is relaxed near both endpoints so routes can
+	// leave and enter harbours.
+	std::vector<WorldPoint> findRoute(const WorldPoint& from, const WorldPoint& to, int minClearance) const;
+	// moves a land point to the nearest water tile within SNAP_RADIUS
+	bool snapToWater(WorldPoint& point) const;
+
+private:
+	void computeClearance(int regionX, int regionY);
+	void computeClearance(int regionX, int regionY, std::vector<unsigned char>& out) const;
+
+	const WorldMap& world;
+	std::unordered_map<int, std::vector<unsigned char>> clearance;
+};
+
+#endif // SEAROUTER_H
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cmath>
+#include "TerrainMesh.h"
+#include "Underlay.h"
+
+void TerrainMesh::smoothHeights(Tile*** tiles, float heights[SIZE + 1][SIZE + 1]) {
+	for (int y = 0; y <= SIZE; ++y) {
+		for (int x = 0; x <= SIZE; ++x) {
+			float sum = 0.f;
+			int count = 0;
+			for (int dy = -1; dy <= 1; ++dy) {
+				for (int dx = -1; dx <= 1; ++dx) {
+					int tx = x + dx;
+					int ty = y + dy;
+					if (tx >= 0 && tx < SIZE && ty >= 0 && ty < SIZE) {
+						sum += tiles[0][tx][ty].height;
+						count++;
+					}
+				}
+			}
+			heights[x][y] = (count > 0 ? sum / count : 0.f) * HEIGHT_SCALE;
+		}
+	}
+}
+
+void TerrainMesh::buildVertices(Tile*** tiles, const float heights[SIZE + 1][SIZE + 1],
+	const std::function<bool(int, int, glm::vec3&)>& colorOverride, std::vector<Vertex>& out) {
+	out.clear();
+	out.reserve(SIZE * SIZE * 6);
+
+	for (int y = 0; y < SIZE; ++y) {
+		for (int x = 0; x < SIZE; ++x) {
+			Tile& tile = tiles[0][x][y];
+			glm::vec3 color;
+			if (!colorOverride || !colorOverride(x, y, color)) {
+				if (tile.overlayId != 0)
+					color = getOverlayRGB(tile.overlayId);
+				else
+					color = getUnderlayRGB(tile.underlayId);
+			}
+			float r = color.r, g = color.g, b = color.b;
+
+			float h00 = heights[x][y];
+			float h10 = heights[x + 1][y];
+			float h11 = heights[x + 1][y + 1];
+			float h01 = heights[x][y + 1];
+
+			float left = x * TILE_SIZE;
+			float right = (x + 1) * TILE_SIZE;
+			float top = (SIZE - 1 - y) * TILE_SIZE;
+			float bottom = (SIZE - 1 - (y + 1)) * TILE_SIZE;
+
+			out.push_back({ left,  h00, top,    r, g, b });
+			out.push_back({ right, h10, top,    r, g, b });
+			out.push_back({ right, h11, bottom, r, g, b });
+
+			out.push_back({ left,  h00, top,    r, g, b });
+			out.push_back({ right, h11, bottom, r, g, b });
+			out.push_back({ left,  h01, bottom, r, g, b });
+		}
+	}
+}
+
+void TerrainMesh::bakeColors(Tile*** tiles, const std::function<bool(int, int, glm::vec3&)>& colorOverride,
+	unsigned char rgb[SIZE * SIZE * 3]) {
+	for (int y = 0; y < SIZE; ++y) {
+		for (int x = 0; x < SIZE; ++x) {
+			Tile& tile = tiles[0][x][y];
+			glm::vec3 color;
+			if (!colorOverride || !colorOverride(x, y, color)) {
+				if (tile.overlayId != 0)
+					color = getOverlayRGB(tile.overlayId);
+				else
+					color = getUnderlayRGB(tile.underlayId);
+			}
+			unsigned char* texel = rgb + (y * SIZE + x) * 3;
+			texel[0] = (unsigned char)(std::clamp(color.r, 0.0f, 1.0f) * 255.0f + 0.5f);
+			texel[1] = (unsigned char)(std::clamp(color.g, 0.0f, 1.0f) * 255.0f + 0.5f);
+			texel[2] = (unsigned char)(std::clamp(color.b, 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+	}
+}
+
+glm::vec3 TerrainMesh::rayFromScreen(float ndcX, float ndcY, const glm::mat4& view, const glm::mat4& projection) {
+	glm::vec4 ray_clip = glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+	glm::vec4 ray_eye = glm::inverse(projection) * ray_clip;
+	ray_eye = glm::vec4(ray_eye.x, ray_eye.y, -1.0, 0.0);
+	glm::vec3 ray_world = glm::vec3(glm::inverse(view) * ray_eye);
+	return glm::normalize(ray_world);
+}
+
+glm::vec3 TerrainMesh::intersectGround(glm::vec3 rayOrigin, glm::vec3 rayDir) {
+	float t = -rayOrigin.y / rayDir.y;
+	return rayOrigin + rayDir * t;
+}
+
+void TerrainMesh::hitToTile(glm::vec3 hit, int& tileX, int& tileY) {
+	tileX = std::clamp(static_cast<int>(std::floor(hit.x / TILE_SIZE)), 0, SIZE - 1);
+	tileY = std::clamp(static_cast<int>(std::floor(hit.z / TILE_SIZE)), 0, SIZE - 1);
+	tileY = (SIZE - 1) - tileY;
+}
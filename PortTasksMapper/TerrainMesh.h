@@ -0,0 +1,40 @@
+#pragma once
+
+#ifndef TERRAINMESH_H
+#define TERRAINMESH_H
+
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Tile.h"
+
+struct Vertex {
+	float x, y, z;
+	float r, g, b;
+};
+
+// CPU side of the region mesh and mouse picking, kept free of GL so it can
+// be benchmarked and run off the render thread.
+class TerrainMesh {
+public:
+	static const int SIZE = 64;
+	static constexpr float TILE_SIZE = 4.0f;
+	static constexpr float HEIGHT_SCALE = 0.3f;
+
+	// 3x3 box-filtered plane 0 heights at every tile corner, in scene units
+	static void smoothHeights(Tile*** tiles, float heights[SIZE + 1][SIZE + 1]);
+	// two triangles per tile; colorOverride(localX, localY, color) replaces the
+	// overlay/underlay colour when it returns true
+	static void buildVertices(Tile*** tiles, const float heights[SIZE + 1][SIZE + 1],
+		const std::function<bool(int, int, glm::vec3&)>& colorOverride, std::vector<Vertex>& out);
+	// top-down RGB8 image of the same colours, one texel per tile, row y = tile y
+	static void bakeColors(Tile*** tiles, const std::function<bool(int, int, glm::vec3&)>& colorOverride,
+		unsigned char rgb[SIZE * SIZE * 3]);
+
+	static glm::vec3 rayFromScreen(float ndcX, float ndcY, const glm::mat4& view, const glm::mat4& projection);
+	static glm::vec3 intersectGround(glm::vec3 rayOrigin, glm::vec3 rayDir);
+	// local tile under a ground hit, clamped to the region
+	static void hitToTile(glm::vec3 hit, int& tileX, int& tileY);
+};
+
+#endif
@@ -12,4 +12,9 @@ typedef struct
 	short underlayId;
 } Tile;
 
+// Tile::settings flags
+const unsigned char TILE_BLOCKED = 0x1;
+// set on plane 1: the tiles below are drawn and walked one plane up
+const unsigned char TILE_BRIDGE = 0x2;
+
 #endif // TILE_H
\ No newline at end of file
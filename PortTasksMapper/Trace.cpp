@@ -0,0 +1,151 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Trace.h"
+
+std::atomic<bool> Trace::recording(false);
+
+namespace
+{
+	struct TraceEvent
+	{
+		const char* name;
+		const char* category;
+		long long startNs;
+		long long endNs;
+	};
+
+	// filled by the owning thread only; readers see entries up to `count`
+	struct Chunk
+	{
+		static const int CAPACITY = 512;
+		TraceEvent events[CAPACITY];
+		std::atomic<int> count{ 0 };
+		std::atomic<Chunk*> next{ nullptr };
+	};
+
+	struct ThreadBuffer
+	{
+		int tid;
+		std::string name;
+		Chunk* head;
+		Chunk* tail;
+	};
+
+	std::mutex registryMutex;
+	std::vector<ThreadBuffer*> registry;
+	std::atomic<long long> sessionStart(0);
+	thread_local ThreadBuffer* localBuffer = nullptr;
+
+	ThreadBuffer* threadBuffer()
+	{
+		if (!localBuffer)
+		{
+			ThreadBuffer* buffer = new ThreadBuffer();
+			buffer->head = buffer->tail = new Chunk();
+
+			std::lock_guard<std::mutex> lock(registryMutex);
+			buffer->tid = (int)registry.size() + 1;
+			buffer->name = "thread " + std::to_string(buffer->tid);
+			registry.push_back(buffer);
+			localBuffer = buffer;
+		}
+		return localBuffer;
+	}
+
+	void writeJsonString(FILE* out, const char* text)
+	{
+		fputc('"', out);
+		for (const char* c = text; *c; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+				fprintf(out, "\\%c", *c);
+			else if ((unsigned char)*c < 0x20)
+				fprintf(out, "\\u%04x", *c);
+			else
+				fputc(*c, out);
+		}
+		fputc('"', out);
+	}
+}
+
+void Trace::start()
+{
+	// earlier events stay in the buffers but are left out of the dump
+	sessionStart = now();
+	recording = true;
+}
+
+void Trace::stop()
+{
+	recording = false;
+}
+
+void Trace::setThreadName(const char* name)
+{
+	ThreadBuffer* buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(registryMutex);
+	buffer->name = name;
+}
+
+void Trace::record(const char* name, const char* category, long long startNs, long long endNs)
+{
+	if (!isRecording())
+		return;
+
+	ThreadBuffer* buffer = threadBuffer();
+	Chunk* chunk = buffer->tail;
+	int index = chunk->count.load(std::memory_order_relaxed);
+	if (index == Chunk::CAPACITY)
+	{
+		Chunk* fresh = new Chunk();
+		chunk->next.store(fresh, std::memory_order_release);
+		buffer->tail = chunk = fresh;
+		index = 0;
+	}
+	chunk->events[index] = { name, category, startNs, endNs };
+	chunk->count.store(index + 1, std::memory_order_release);
+}
+
+bool Trace::dump(const char* filename)
+{
+	FILE* out = fopen(filename, "w");
+	if (!out)
+		return false;
+
+	long long origin = sessionStart.load();
+	bool first = true;
+	fprintf(out, "{\"traceEvents\":[");
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (const ThreadBuffer* buffer : registry)
+	{
+		fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",", buffer->tid);
+		writeJsonString(out, buffer->name.c_str());
+		fprintf(out, "}}");
+		first = false;
+
+		for (const Chunk* chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+		{
+			int count = chunk->count.load(std::memory_order_acquire);
+			for (int i = 0; i < count; ++i)
+			{
+				const TraceEvent& e = chunk->events[i];
+				if (e.startNs < origin)
+					continue;
+				fprintf(out, ",\n{\"name\":");
+				writeJsonString(out, e.name);
+				fprintf(out, ",\"cat\":");
+				writeJsonString(out, e.category);
+				fprintf(out, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+					(e.startNs - origin) / 1000.0, (e.endNs - e.startNs) / 1000.0, buffer->tid);
+			}
+		}
+	}
+
+	fprintf(out, "\n]}\n");
+	return fclose(out) == 0;
+}
@@ -0,0 +1,55 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+
+// Timeline of scoped events written as Chrome trace JSON (load the file in
+// chrome://tracing or Perfetto). Each thread appends to its own chunked
+// buffer without locking; the registry lock is only taken the first time a
+// thread records and when dumping. Nothing is recorded unless started.
+class Trace
+{
+public:
+	static void start();
+	static void stop();
+	static bool isRecording() { return recording.load(std::memory_order_relaxed); }
+
+	// Names the calling thread in the dump.
+	static void setThreadName(const char* name);
+	// Writes every event recorded since start(); safe while recording.
+	static bool dump(const char* filename);
+
+	static long long now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+	// name and category must outlive the trace (string literals)
+	static void record(const char* name, const char* category, long long startNs, long long endNs);
+
+private:
+	static std::atomic<bool> recording;
+};
+
+class TraceScope
+{
+public:
+	TraceScope(const char* name, const char* category)
+		: name(name), category(category), startNs(Trace::isRecording() ? Trace::now() : 0) {}
+	~TraceScope()
+	{
+		if (startNs)
+			Trace::record(name, category, startNs, Trace::now());
+	}
+
+private:
+	const char* name;
+	const char* category;
+	long long startNs;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, category)
+
+#endif // TRACE_H
@@ -732,6 +732,28 @@ glm::vec3 getUnderlayRGB(int id)
 
 const int overlayColorsCount = sizeof(overlayColors) / sizeof(OverlayColor);
 
+// overlays that render as open water (rivers, lakes, sea)
+const int waterOverlayIds[] = {
+	6, 17, 37, 39, 40, 150, 157, 332
+};
+
+const int waterOverlayIdsCount = sizeof(waterOverlayIds) / sizeof(int);
+
+size_t colorTableBytes()
+{
+	return sizeof(UnderlayColor) * underlayColorsCount + sizeof(OverlayColor) * overlayColorsCount + sizeof(waterOverlayIds);
+}
+
+bool isWaterOverlay(int id)
+{
+	for (int i = 0; i < waterOverlayIdsCount; ++i)
+	{
+		if (waterOverlayIds[i] == id)
+			return true;
+	}
+	return false;
+}
+
 glm::vec3 getOverlayRGB(int id)
 {
 	const int overlayCount = sizeof(overlayColors) / sizeof(OverlayColor);
@@ -1,6 +1,7 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <cstdint>
+#include <cstddef>
 
 struct UnderlayColor
 {
@@ -20,6 +21,10 @@ extern const UnderlayColor underlayColors[];
 extern const OverlayColor overlayColors[];
 extern const int underlayColorsCount;
 extern const int overlayColorsCount;
+extern const int waterOverlayIds[];
+extern const int waterOverlayIdsCount;
 
 glm::vec3 getUnderlayRGB(int id);
-glm::vec3 getOverlayRGB(int id);
\ No newline at end of file
+glm::vec3 getOverlayRGB(int id);
+bool isWaterOverlay(int id);
+size_t colorTableBytes();
\ No newline at end of file
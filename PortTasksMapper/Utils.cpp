@@ -2,10 +2,17 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "Utils.h"
+#include "JobSystem.h"
+#include "Trace.h"
 
 unsigned char* loadFileBytes(const char* filename, size_t* outSize)
 {
+	TRACE_SCOPE("loadFileBytes", "io");
 	FILE* file = fopen(filename, "rb");
 	if (!file) return nullptr;
 
@@ -22,3 +29,29 @@ unsigned char* loadFileBytes(const char* filename, size_t* outSize)
 	*outSize = size;
 	return buffer;
 }
+
+void parallelFor(int count, int threads, const std::function<void(int)>& body)
+{
+	if (threads <= 1 || count <= 1)
+	{
+		for (int i = 0; i < count; ++i)
+			body(i);
+		return;
+	}
+
+	// one pool job per requested thread, each pulling indices, so uneven
+	// items still balance and nested loops share the pool's cores
+	std::atomic<int> next(0);
+	int tasks = std::min(threads, count);
+	JobSystem::parallelFor(tasks, 1, [&](int, int)
+	{
+		for (int i = next++; i < count; i = next++)
+			body(i);
+	});
+}
+
+int defaultThreadCount()
+{
+	unsigned int n = std::thread::hardware_concurrency();
+	return n ? (int)n : 1;
+}
@@ -2,7 +2,13 @@
 #define FILEUTILS_H
 
 #include <stddef.h>
+#include <functional>
 
 unsigned char* loadFileBytes(const char* filename, size_t* outSize);
 
+// Runs body(0..count-1) on up to `threads` threads of the shared job pool
+// (the caller is one of them).
+void parallelFor(int count, int threads, const std::function<void(int)>& body);
+int defaultThreadCount();
+
 #endif // FILEUTILS_H
@@ -0,0 +1,163 @@
+#include <iterator>
+#include "WorldComponents.h"
+#include "Underlay.h"
+#include "Utils.h"
+
+namespace
+{
+	const int N = WorldMap::REGION_SIZE;
+
+	int find(std::vector<int>& parent, int i)
+	{
+		while (parent[i] != i)
+		{
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	}
+
+	void unite(std::vector<int>& parent, int a, int b)
+	{
+		a = find(parent, a);
+		b = find(parent, b);
+		if (a != b)
+			parent[a < b ? b : a] = a < b ? a : b;
+	}
+}
+
+void WorldComponents::build(const WorldMap& world, int threads)
+{
+	std::vector<int> regionIds = world.regionIds();
+
+	const int regionCount = (int)regionIds.size();
+	std::unordered_map<int, int> slotOf;
+	for (int i = 0; i < regionCount; ++i)
+		slotOf[regionIds[i]] = i;
+
+	// local labels of regions that are gone are dropped; new ones are scanned
+	for (auto it = local.begin(); it != local.end();)
+		it = slotOf.count(it->first) ? std::next(it) : local.erase(it);
+	std::vector<int> scan;
+	for (int id : regionIds)
+		if (!local.count(id))
+			scan.push_back(id);
+	std::vector<LocalLabels*> targets;
+	for (int id : scan)
+		targets.push_back(&local[id]);
+
+	// pass 1: per region union-find over local tile ids x * N + y
+	parallelFor((int)scan.size(), threads, [&](int i)
+	{
+		RegionRef region = world.region(WorldMap::regionX(scan[i]), WorldMap::regionY(scan[i]));
+		LocalLabels& out = *targets[i];
+		out.water.resize(N * N);
+		out.root.resize(N * N);
+		for (int x = 0; x < N; ++x)
+		{
+			for (int y = 0; y < N; ++y)
+			{
+				int t = x * N + y;
+				out.root[t] = t;
+				out.water[t] = isWaterOverlay(region.tile(0, x, y).overlayId);
+				if (x > 0 && out.water[t - N] == out.water[t])
+					unite(out.root, t - N, t);
+				if (y > 0 && out.water[t - 1] == out.water[t])
+					unite(out.root, t - 1, t);
+			}
+		}
+		for (int t = 0; t < N * N; ++t)
+			out.root[t] = find(out.root, t);
+	});
+
+	// a tile's global id is slot * N * N + local id
+	std::vector<char> water(regionCount * N * N);
+	std::vector<int> parent(regionCount * N * N);
+	parallelFor(regionCount, threads, [&](int slot)
+	{
+		const LocalLabels& region = local.find(regionIds[slot])->second;
+		const int base = slot * N * N;
+		for (int t = 0; t < N * N; ++t)
+		{
+			water[base + t] = region.water[t];
+			parent[base + t] = base + region.root[t];
+		}
+	});
+
+	// pass 2: join along the east and north border of every region
+	for (int slot = 0; slot < regionCount; ++slot)
+	{
+		int rx = WorldMap::regionX(regionIds[slot]);
+		int ry = WorldMap::regionY(regionIds[slot]);
+		const int base = slot * N * N;
+
+		auto east = slotOf.find(WorldMap::regionId(rx + 1, ry));
+		if (east != slotOf.end())
+		{
+			const int other = east->second * N * N;
+			for (int y = 0; y < N; ++y)
+				if (water[base + (N - 1) * N + y] == water[other + y])
+					unite(parent, base + (N - 1) * N + y, other + y);
+		}
+
+		auto north = slotOf.find(WorldMap::regionId(rx, ry + 1));
+		if (north != slotOf.end())
+		{
+			const int other = north->second * N * N;
+			for (int x = 0; x < N; ++x)
+				if (water[base + x * N + N - 1] == water[other + x * N])
+					unite(parent, base + x * N + N - 1, other + x * N);
+		}
+	}
+
+	// pass 3: dense component ids
+	std::vector<int> dense(parent.size(), -1);
+	componentWater.clear();
+	componentSize.clear();
+	labels.clear();
+	for (int slot = 0; slot < regionCount; ++slot)
+	{
+		std::vector<int>& out = labels[regionIds[slot]];
+		out.resize(N * N);
+		for (int t = 0; t < N * N; ++t)
+		{
+			int i = slot * N * N + t;
+			int root = find(parent, i);
+			if (dense[root] < 0)
+			{
+				dense[root] = (int)componentSize.size();
+				componentSize.push_back(0);
+				componentWater.push_back(water[root]);
+			}
+			out[t] = dense[root];
+			++componentSize[dense[root]];
+		}
+	}
+}
+
+void WorldComponents::invalidate(int regionX, int regionY)
+{
+	local.erase(WorldMap::regionId(regionX, regionY));
+}
+
+int WorldComponents::componentAt(int x, int y) const
+{
+	if (x < 0 || y < 0)
+		return -1;
+
+	auto it = labels.find(WorldMap::regionId(x / N, y / N));
+	if (it == labels.end())
+		return -1;
+
+	return it->second[(x % N) * N + (y % N)];
+}
+
+size_t WorldComponents::memoryBytes() const
+{
+	size_t bytes = labels.bucket_count() * sizeof(void*) + componentWater.capacity() + componentSize.capacity() * sizeof(int);
+	for (const auto& region : labels)
+		bytes += sizeof(region) + region.second.capacity() * sizeof(int);
+	for (const auto& region : local)
+		bytes += sizeof(region) + region.second.water.capacity() + region.second.root.capacity() * sizeof(int);
+	return bytes;
+}
@@ -0,0 +1,41 @@
+#ifndef WORLDCOMPONENTS_H
+#define WORLDCOMPONENTS_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include "WorldMap.h"
+
+// Connected water bodies and landmasses on plane 0 across every loaded
+// region (4-connected). Regions are labelled in parallel with a local
+// union-find, then labels touching across region borders are merged.
+// Local labels are kept between builds, so a rebuild only rescans regions
+// that are new or invalidated; the border merge and numbering are redone.
+class WorldComponents
+{
+public:
+	void build(const WorldMap& world, int threads);
+	// the region's tiles changed; it is rescanned on the next build
+	void invalidate(int regionX, int regionY);
+
+	// -1 when the tile is not loaded
+	int componentAt(int x, int y) const;
+	bool isWater(int component) const { return component >= 0 && componentWater[component]; }
+	int size(int component) const { return component >= 0 ? componentSize[component] : 0; }
+	int count() const { return (int)componentSize.size(); }
+	size_t memoryBytes() const;
+
+private:
+	// per region: water flag and local union-find root of every tile
+	struct LocalLabels
+	{
+		std::vector<char> water;
+		std::vector<int> root;
+	};
+	std::unordered_map<int, LocalLabels> local;
+	std::unordered_map<int, std::vector<int>> labels;
+	std::vector<char> componentWater;
+	std::vector<int> componentSize;
+};
+
+#endif // WORLDCOMPONENTS_H
@@ -0,0 +1,365 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include "WorldMap.h"
+#include "BatchReader.h"
+#include "JobSystem.h"
+#include "MapLoader.h"
+#include "MemoryStats.h"
+#include "Underlay.h"
+#include "Utils.h"
+
+WorldMap::~WorldMap()
+{
+	for (auto& entry : regionTiles)
+		MapLoader::freeTerrain(entry.second);
+	for (auto& entry : packedRegions)
+		MemoryStats::add(MemoryCategory::Tiles, -(long long)entry.second.memoryBytes());
+	for (auto& entry : regionObjects)
+		MemoryStats::add(MemoryCategory::Objects, -(long long)entry.second.memoryBytes());
+}
+
+void WorldMap::addRegion(int regionX, int regionY, Tile*** tiles)
+{
+	if (compress)
+	{
+		// only the terrain is replaced; the region's objects stay
+		freeUnpacked(regionId(regionX, regionY));
+		addPacked(regionId(regionX, regionY), PackedRegion(tiles));
+		MapLoader::freeTerrain(tiles);
+		return;
+	}
+
+	Tile***& slot = regionTiles[regionId(regionX, regionY)];
+	if (slot && slot != tiles)
+		MapLoader::freeTerrain(slot);
+	slot = tiles;
+}
+
+void WorldMap::addPacked(int id, PackedRegion&& packed)
+{
+	MemoryStats::add(MemoryCategory::Tiles, (long long)packed.memoryBytes());
+	auto existing = packedRegions.find(id);
+	if (existing != packedRegions.end())
+	{
+		MemoryStats::add(MemoryCategory::Tiles, -(long long)existing->second.memoryBytes());
+		packedRegions.erase(existing);
+	}
+	packedRegions.emplace(id, std::move(packed));
+}
+
+void WorldMap::freeUnpacked(int id)
+{
+	auto tiles = regionTiles.find(id);
+	if (tiles != regionTiles.end())
+	{
+		MapLoader::freeTerrain(tiles->second);
+		regionTiles.erase(tiles);
+	}
+}
+
+void WorldMap::removeRegion(int regionX, int regionY)
+{
+	freeUnpacked(regionId(regionX, regionY));
+	auto packed = packedRegions.find(regionId(regionX, regionY));
+	if (packed != packedRegions.end())
+	{
+		MemoryStats::add(MemoryCategory::Tiles, -(long long)packed->second.memoryBytes());
+		packedRegions.erase(packed);
+	}
+	auto objects = regionObjects.find(regionId(regionX, regionY));
+	if (objects != regionObjects.end())
+	{
+		MemoryStats::add(MemoryCategory::Objects, -(long long)objects->second.memoryBytes());
+		regionObjects.erase(objects);
+	}
+}
+
+bool WorldMap::loadRegion(int regionX, int regionY, const char* directory)
+{
+	char path[512];
+	snprintf(path, sizeof(path), "%s/m%d_%d.dat", directory, regionX, regionY);
+
+	size_t bufSize;
+	unsigned char* buf = loadFileBytes(path, &bufSize);
+	if (!buf)
+		return false;
+
+	addRegion(regionX, regionY, MapLoader::loadTerrain(buf, bufSize));
+	free(buf);
+	return true;
+}
+
+void WorldMap::setObjects(int regionX, int regionY, RegionObjects&& objects)
+{
+	RegionObjects& slot = regionObjects[regionId(regionX, regionY)];
+	MemoryStats::add(MemoryCategory::Objects, (long long)objects.memoryBytes() - (long long)slot.memoryBytes());
+	slot = std::move(objects);
+}
+
+const RegionObjects* WorldMap::getObjects(int regionX, int regionY) const
+{
+	auto it = regionObjects.find(regionId(regionX, regionY));
+	return it == regionObjects.end() ? nullptr : &it->second;
+}
+
+bool WorldMap::readObjects(int regionX, int regionY, const char* directory, const XteaKeyStore* keys, RegionObjects& out)
+{
+	char path[512];
+	snprintf(path, sizeof(path), "%s/l%d_%d.dat", directory, regionX, regionY);
+
+	size_t bufSize;
+	unsigned char* buf = loadFileBytes(path, &bufSize);
+	if (!buf)
+		return false;
+
+	if (keys)
+		xteaDecipher(buf, bufSize, keys->find(regionId(regionX, regionY)));
+	bool decoded = MapLoader::loadLocations(buf, bufSize, out);
+	free(buf);
+	if (!decoded)
+	{
+		fprintf(stderr, "%s does not decode; missing or wrong XTEA key?\n", path);
+		out.clear();
+	}
+	return decoded;
+}
+
+std::vector<std::pair<int, int>> WorldMap::loadRegions(const std::vector<std::pair<int, int>>& coords, const char* directory, int threads)
+{
+	std::vector<std::string> paths(coords.size());
+	for (size_t i = 0; i < coords.size(); ++i)
+	{
+		char path[512];
+		snprintf(path, sizeof(path), "%s/m%d_%d.dat", directory, coords[i].first, coords[i].second);
+		paths[i] = path;
+	}
+
+	// packing happens in the decode jobs too, so at most one unpacked region per thread is alive
+	std::vector<Tile***> decoded(coords.size(), nullptr);
+	std::vector<std::unique_ptr<PackedRegion>> packed(coords.size());
+	auto decode = [&](int i, unsigned char* buf, size_t bufSize)
+	{
+		decoded[i] = MapLoader::loadTerrain(buf, bufSize);
+		free(buf);
+		if (compress)
+		{
+			packed[i].reset(new PackedRegion(decoded[i]));
+			MapLoader::freeTerrain(decoded[i]);
+			decoded[i] = nullptr;
+		}
+	};
+
+	if (!BatchReader::isBatched())
+	{
+		parallelFor((int)coords.size(), threads, [&](int i)
+		{
+			size_t bufSize;
+			unsigned char* buf = loadFileBytes(paths[i].c_str(), &bufSize);
+			if (buf)
+				decode(i, buf, bufSize);
+		});
+	}
+	else if (threads <= 1)
+		BatchReader::readAll(paths, decode);
+	else
+	{
+		// each file is decoded as soon as its read completes, overlapping disk
+		// and decode, by at most `threads` jobs draining the finished buffers
+		struct ReadFile
+		{
+			int index;
+			unsigned char* buf;
+			size_t size;
+		};
+		std::mutex readyMutex;
+		std::deque<ReadFile> ready;
+		int draining = 0;
+		auto drain = [&]()
+		{
+			for (;;)
+			{
+				ReadFile file;
+				{
+					std::lock_guard<std::mutex> lock(readyMutex);
+					if (ready.empty())
+					{
+						--draining;
+						return;
+					}
+					file = ready.front();
+					ready.pop_front();
+				}
+				decode(file.index, file.buf, file.size);
+			}
+		};
+
+		Job root;
+		std::deque<Job> drainers;
+		BatchReader::readAll(paths, [&](int i, unsigned char* buf, size_t bufSize)
+		{
+			{
+				std::lock_guard<std::mutex> lock(readyMutex);
+				ready.push_back({ i, buf, bufSize });
+				if (draining >= threads)
+					return;
+				++draining;
+			}
+			drainers.emplace_back();
+			drainers.back().work = drain;
+			drainers.back().parent = &root;
+			JobSystem::run(drainers.back());
+		});
+		JobSystem::run(root);
+		JobSystem::wait(root);
+	}
+
+	std::vector<std::pair<int, int>> loaded;
+	for (size_t i = 0; i < coords.size(); ++i)
+	{
+		if (packed[i])
+		{
+			freeUnpacked(regionId(coords[i].first, coords[i].second));
+			addPacked(regionId(coords[i].first, coords[i].second), std::move(*packed[i]));
+			loaded.push_back(coords[i]);
+		}
+		else if (decoded[i])
+		{
+			addRegion(coords[i].first, coords[i].second, decoded[i]);
+			loaded.push_back(coords[i]);
+		}
+	}
+	return loaded;
+}
+
+std::vector<std::pair<int, int>> WorldMap::listRegions(const char* directory)
+{
+	std::vector<std::pair<int, int>> coords;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		int rx, ry, end = 0;
+		std::string name = entry.path().filename().string();
+		if (sscanf(name.c_str(), "m%d_%d.dat%n", &rx, &ry, &end) == 2 && end == (int)name.size()
+			&& rx >= 0 && rx < 256 && ry >= 0 && ry < 256)
+			coords.push_back({ rx, ry });
+	}
+	return coords;
+}
+
+Tile*** WorldMap::getRegion(int regionX, int regionY) const
+{
+	auto it = regionTiles.find(regionId(regionX, regionY));
+	return it != regionTiles.end() ? it->second : nullptr;
+}
+
+RegionRef WorldMap::region(int regionX, int regionY) const
+{
+	RegionRef ref;
+	int id = regionId(regionX, regionY);
+	auto tiles = regionTiles.find(id);
+	if (tiles != regionTiles.end())
+	{
+		ref.tiles = tiles->second;
+		return ref;
+	}
+	auto packed = packedRegions.find(id);
+	if (packed != packedRegions.end())
+		ref.packed = &packed->second;
+	return ref;
+}
+
+bool WorldMap::hasRegion(int regionX, int regionY) const
+{
+	int id = regionId(regionX, regionY);
+	return regionTiles.count(id) != 0 || packedRegions.count(id) != 0;
+}
+
+std::vector<int> WorldMap::regionIds() const
+{
+	std::vector<int> ids;
+	ids.reserve(regionTiles.size() + packedRegions.size());
+	for (const auto& entry : regionTiles)
+		ids.push_back(entry.first);
+	for (const auto& entry : packedRegions)
+		ids.push_back(entry.first);
+	return ids;
+}
+
+unsigned long long WorldMap::regionHash(int regionX, int regionY) const
+{
+	RegionRef ref = region(regionX, regionY);
+	if (!ref)
+		return 0;
+
+	unsigned long long hash = 1469598103934665603ULL;
+	auto mix = [&hash](int value)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= 1099511628211ULL;
+		}
+	};
+
+	for (int z = 0; z < 4; ++z)
+	{
+		for (int x = 0; x < REGION_SIZE; ++x)
+		{
+			for (int y = 0; y < REGION_SIZE; ++y)
+			{
+				const Tile tile = ref.tile(z, x, y);
+				mix(tile.height);
+				mix(tile.attrOpcode);
+				mix(tile.settings);
+				mix(tile.overlayId);
+				mix(tile.underlayId);
+			}
+		}
+	}
+	return hash;
+}
+
+bool WorldMap::tileAt(int x, int y, int plane, Tile& out) const
+{
+	if (x < 0 || y < 0 || plane < 0 || plane > 3)
+		return false;
+
+	RegionRef ref = region(x / REGION_SIZE, y / REGION_SIZE);
+	if (!ref)
+		return false;
+
+	out = ref.tile(plane, x % REGION_SIZE, y % REGION_SIZE);
+	return true;
+}
+
+bool WorldMap::setTile(int x, int y, int plane, const Tile& tile)
+{
+	if (x < 0 || y < 0 || plane < 0 || plane > 3)
+		return false;
+
+	Tile*** tiles = getRegion(x / REGION_SIZE, y / REGION_SIZE);
+	if (!tiles)
+		return false;
+
+	tiles[plane][x % REGION_SIZE][y % REGION_SIZE] = tile;
+	return true;
+}
+
+bool WorldMap::isWater(int x, int y) const
+{
+	Tile tile;
+	return tileAt(x, y, 0, tile) && isWaterOverlay(tile.overlayId);
+}
+
+bool WorldMap::isWalkable(int x, int y, int plane) const
+{
+	Tile tile;
+	if (!tileAt(x, y, plane, tile))
+		return false;
+
+	return (tile.settings & TILE_BLOCKED) == 0 && !isWaterOverlay(tile.overlayId);
+}
@@ -0,0 +1,90 @@
+#ifndef WORLDMAP_H
+#define WORLDMAP_H
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Tile.h"
+#include "PackedRegion.h"
+#include "RegionObjects.h"
+#include "Xtea.h"
+
+// Read access to one region, however the world map stores it.
+struct RegionRef
+{
+	Tile*** tiles = nullptr;
+	const PackedRegion* packed = nullptr;
+
+	explicit operator bool() const { return tiles || packed; }
+	Tile tile(int plane, int x, int y) const { return tiles ? tiles[plane][x][y] : packed->tile(plane, x, y); }
+};
+
+// Decoded terrain (and, where available, objects) for every loaded region,
+// addressed by world tile coordinate. Regions are kept as Tile arrays, or
+// read-only PackedRegions once setCompressed(true) is called, which lets a
+// whole world stay resident.
+class WorldMap
+{
+public:
+	static const int REGION_SIZE = 64;
+
+	static int regionId(int regionX, int regionY) { return regionX << 8 | regionY; }
+	static int regionX(int regionId) { return regionId >> 8; }
+	static int regionY(int regionId) { return regionId & 0xFF; }
+
+	WorldMap() = default;
+	WorldMap(const WorldMap&) = delete;
+	WorldMap& operator=(const WorldMap&) = delete;
+	~WorldMap();
+
+	// regions added from now on are packed (and their tiles freed); they can no longer be edited
+	void setCompressed(bool compressed) { compress = compressed; }
+	bool isCompressed() const { return compress; }
+
+	// takes ownership of tiles, freeing any region already at these coordinates
+	void addRegion(int regionX, int regionY, Tile*** tiles);
+	// frees the region's tiles and objects
+	void removeRegion(int regionX, int regionY);
+	bool loadRegion(int regionX, int regionY, const char* directory);
+	// Decodes the regions on up to `threads` threads and adds the ones found;
+	// returns those. Where BatchReader batches, files are read together and
+	// decoded as they arrive.
+	std::vector<std::pair<int, int>> loadRegions(const std::vector<std::pair<int, int>>& coords, const char* directory, int threads);
+	// Coordinates of every m<x>_<y>.dat file in the directory.
+	static std::vector<std::pair<int, int>> listRegions(const char* directory);
+	// null for packed regions; use region() to read either kind
+	Tile*** getRegion(int regionX, int regionY) const;
+	RegionRef region(int regionX, int regionY) const;
+	bool hasRegion(int regionX, int regionY) const;
+	// every loaded region, packed or not
+	std::vector<int> regionIds() const;
+	// takes the region's objects, replacing any it had
+	void setObjects(int regionX, int regionY, RegionObjects&& objects);
+	const RegionObjects* getObjects(int regionX, int regionY) const;
+	// Reads l<x>_<y>.dat (decompressed, like the m files) and decrypts it with
+	// the region's key; false if the file is missing or does not decode.
+	static bool readObjects(int regionX, int regionY, const char* directory, const XteaKeyStore* keys, RegionObjects& out);
+	// FNV-1a over every decoded tile field of the region, 0 if not loaded
+	unsigned long long regionHash(int regionX, int regionY) const;
+
+	bool tileAt(int x, int y, int plane, Tile& out) const;
+	// false for unloaded and packed regions
+	bool setTile(int x, int y, int plane, const Tile& tile);
+	bool isWater(int x, int y) const;
+	bool isWalkable(int x, int y, int plane) const;
+
+	// the unpacked regions only
+	const std::unordered_map<int, Tile***>& regions() const { return regionTiles; }
+
+private:
+	void addPacked(int id, PackedRegion&& packed);
+	// drops the region's unpacked tiles, if any, leaving packed tiles and objects
+	void freeUnpacked(int id);
+
+	bool compress = false;
+	std::unordered_map<int, Tile***> regionTiles;
+	std::unordered_map<int, PackedRegion> packedRegions;
+	std::unordered_map<int, RegionObjects> regionObjects;
+};
+
+#endif // WORLDMAP_H
@@ -0,0 +1,21 @@
+#ifndef WORLDPOINT_H
+#define WORLDPOINT_H
+
+struct WorldPoint
+{
+	int x;
+	int y;
+	int plane;
+};
+
+inline bool operator==(const WorldPoint& a, const WorldPoint& b)
+{
+	return a.x == b.x && a.y == b.y && a.plane == b.plane;
+}
+
+inline bool operator!=(const WorldPoint& a, const WorldPoint& b)
+{
+	return !(a == b);
+}
+
+#endif // WORLDPOINT_H
@@ -0,0 +1,106 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <iostream>
+#include "Xtea.h"
+
+namespace
+{
+	const unsigned int GOLDEN_RATIO = 0x9E3779B9;
+	const int ROUNDS = 32;
+
+	unsigned int readInt(const unsigned char* p)
+	{
+		return (unsigned int)p[0] << 24 | (unsigned int)p[1] << 16 | (unsigned int)p[2] << 8 | p[3];
+	}
+
+	void writeInt(unsigned char* p, unsigned int value)
+	{
+		p[0] = (unsigned char)(value >> 24);
+		p[1] = (unsigned char)(value >> 16);
+		p[2] = (unsigned char)(value >> 8);
+		p[3] = (unsigned char)value;
+	}
+}
+
+void xteaDecipher(unsigned char* data, size_t length, const XteaKey& key)
+{
+	if (key.isZero())
+		return;
+
+	const unsigned int* k = (const unsigned int*)key.k;
+	for (size_t block = 0; block + 8 <= length; block += 8)
+	{
+		unsigned int v0 = readInt(data + block);
+		unsigned int v1 = readInt(data + block + 4);
+		unsigned int sum = GOLDEN_RATIO * ROUNDS;
+		for (int i = 0; i < ROUNDS; ++i)
+		{
+			v1 -= (((v0 << 4) ^ (v0 >> 5)) + v0) ^ (sum + k[(sum >> 11) & 3]);
+			sum -= GOLDEN_RATIO;
+			v0 -= (((v1 << 4) ^ (v1 >> 5)) + v1) ^ (sum + k[sum & 3]);
+		}
+		writeInt(data + block, v0);
+		writeInt(data + block + 4, v1);
+	}
+}
+
+void xteaEncipher(unsigned char* data, size_t length, const XteaKey& key)
+{
+	if (key.isZero())
+		return;
+
+	const unsigned int* k = (const unsigned int*)key.k;
+	for (size_t block = 0; block + 8 <= length; block += 8)
+	{
+		unsigned int v0 = readInt(data + block);
+		unsigned int v1 = readInt(data + block + 4);
+		unsigned int sum = 0;
+		for (int i = 0; i < ROUNDS; ++i)
+		{
+			v0 += (((v1 << 4) ^ (v1 >> 5)) + v1) ^ (sum + k[sum & 3]);
+			sum += GOLDEN_RATIO;
+			v1 += (((v0 << 4) ^ (v0 >> 5)) + v0) ^ (sum + k[(sum >> 11) & 3]);
+		}
+		writeInt(data + block, v0);
+		writeInt(data + block + 4, v1);
+	}
+}
+
+bool XteaKeyStore::load(const char* filename)
+{
+	FILE* file = fopen(filename, "r");
+	if (!file)
+		return false;
+
+	char line[256];
+	int lineNumber = 0;
+	while (fgets(line, sizeof(line), file))
+	{
+		++lineNumber;
+		const char* p = line;
+		while (*p == ' ' || *p == '\t')
+			++p;
+		if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+			continue;
+
+		int regionId;
+		XteaKey key;
+		if (sscanf(p, "%d %d %d %d %d", &regionId, &key.k[0], &key.k[1], &key.k[2], &key.k[3]) != 5)
+		{
+			std::cerr << filename << ":" << lineNumber << ": expected <regionId> <k0> <k1> <k2> <k3>\n";
+			continue;
+		}
+		keys[regionId] = key;
+	}
+	fclose(file);
+	return true;
+}
+
+XteaKey XteaKeyStore::find(int regionId) const
+{
+	auto it = keys.find(regionId);
+	if (it == keys.end())
+		return XteaKey{ { 0, 0, 0, 0 } };
+	return it->second;
+}
@@ -0,0 +1,37 @@
+#ifndef XTEA_H
+#define XTEA_H
+
+#include <stddef.h>
+#include <unordered_map>
+
+// XTEA as the RS2 cache uses it: 32 rounds over big-endian 8-byte blocks,
+// trailing bytes that do not fill a block are left as they are. An all-zero
+// key means the data is not encrypted.
+struct XteaKey
+{
+	int k[4];
+
+	bool isZero() const { return (k[0] | k[1] | k[2] | k[3]) == 0; }
+};
+
+void xteaDecipher(unsigned char* data, size_t length, const XteaKey& key);
+void xteaEncipher(unsigned char* data, size_t length, const XteaKey& key);
+
+// Region keys read from a local text file, one region per line:
+//   <regionId> <k0> <k1> <k2> <k3>
+// where regionId = regionX << 8 | regionY. Blank lines and lines starting
+// with '#' are skipped. Read-only after load, so workers can share it.
+class XteaKeyStore
+{
+public:
+	// returns false if the file cannot be opened; malformed lines are reported and skipped
+	bool load(const char* filename);
+	// the region's key, or the zero key when none is known
+	XteaKey find(int regionId) const;
+	size_t size() const { return keys.size(); }
+
+private:
+	std::unordered_map<int, XteaKey> keys;
+};
+
+#endif // XTEA_H